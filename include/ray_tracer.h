@@ -2,9 +2,12 @@
 #define RAY_TRACER_H_INCLUDED__
 
 #include <stdlib.h>
+#include <stddef.h>
 #include <math.h>
+#include "ray_tracer_real.h"
 
 #define RAY_TRACER_MIN(X, Y) (((X) < (Y)) ? (X) : (Y))
+#define RAY_TRACER_MAX(X, Y) (((X) < (Y)) ? (Y) : (X))
 
 typedef enum
 {
@@ -19,7 +22,7 @@ typedef struct
 
 typedef struct
 {
-    float coords[3];
+    real_t coords[3];
 } world_point;
 
 typedef struct
@@ -27,7 +30,7 @@ typedef struct
     color_t color;
     world_point normal;
     int specularity;
-    float reflectivity;
+    real_t reflectivity;
 } material_t;
 
 typedef world_point world_vector;
@@ -41,15 +44,27 @@ typedef struct
 typedef struct
 {
     world_point center;
-    float radius;
+    real_t radius;
 } world_sphere;
 
 typedef struct
 {
     world_point normal;
-    float D;
+    real_t D;
 } world_plane;
 
+typedef struct
+{
+    world_point min;
+    world_point max;
+} world_box;
+
+//  Affine transform: rows of the 3x3 linear part followed by the translation column
+typedef struct
+{
+    real_t m[3][4];
+} world_transform;
+
 typedef struct
 {
     int coords[2];
@@ -58,37 +73,62 @@ typedef struct
 void zero(world_point* const p);
 world_point sum(world_point const p1, world_point const p2);
 world_point sub(world_point const p1, world_point const p2);
-color_t mul_color_by_factor(color_t const color, float factor);
-world_point mul_by_factor(world_point const p1, float factor);
+color_t mul_color_by_factor(color_t const color, real_t factor);
+world_point mul_by_factor(world_point const p1, real_t factor);
 world_point reflect(world_point dir, world_point normal);
 world_line create_line(world_point const origin, world_point const dir);
-float length(const world_point p);
+real_t length(const world_point p);
 world_point normalize(const world_point p);
-world_point line_point(world_line line, float t);
-float scalar_product(world_point const p1, world_point const p2);
-intersection_result intersect_line_with_sphere(const world_line* const line, world_sphere* const sphere, float* const t);
-intersection_result intersect_line_with_plane(const world_line* const line, world_plane* const plane, float* const t);
-intersection_result intersect_ray_with_line(const world_line* const ray, const world_line* const line2, float* const t);
-intersection_result intersect_line_with_poly(const world_line* const line, const world_point* vertices, const int count, float* const t);
-int solve_quadratic(float a, float b, float c, float* const t);
-color_t lerp_color(const color_t lhs, const color_t rhs, const float t);
+world_point line_point(world_line line, real_t t);
+real_t scalar_product(world_point const p1, world_point const p2);
+world_vector cross_product(world_vector const v1, world_vector const v2);
+intersection_result intersect_line_with_sphere(const world_line* const line, world_sphere* const sphere, real_t* const t);
+intersection_result intersect_line_with_plane(const world_line* const line, world_plane* const plane, real_t* const t);
+intersection_result intersect_ray_with_line(const world_line* const ray, const world_line* const line2, real_t* const t);
+intersection_result intersect_line_with_poly(const world_line* const line, const world_point* vertices, const int count, real_t* const t);
+int solve_quadratic(real_t a, real_t b, real_t c, real_t* const t);
+color_t lerp_color(const color_t lhs, const color_t rhs, const real_t t);
+
+world_box empty_box(void);
+world_box merge_boxes(const world_box lhs, const world_box rhs);
+world_box sphere_box(const world_sphere* const sphere);
+world_box poly_box(const world_point* vertices, const int count);
+intersection_result intersect_line_with_box(const world_line* const line, const world_box* const box, real_t tmin, real_t tmax);
+
+world_transform identity_transform(void);
+world_transform translation_transform(const world_vector offset);
+world_transform scale_transform(const world_vector factors);
+world_transform rotation_transform(const world_vector axis, const real_t angle);
+world_transform compose_transforms(const world_transform* const outer, const world_transform* const inner);
+int invert_transform(const world_transform* const transform, world_transform* const inverse);
+world_point transform_point(const world_transform* const transform, const world_point p);
+world_vector transform_vector(const world_transform* const transform, const world_vector v);
+world_vector transform_normal(const world_transform* const inverse, const world_vector n);
+world_box transform_box(const world_transform* const transform, const world_box box);
 
 typedef void (*put_pixel_callback)(screen_point point, color_t value);
 
-typedef intersection_result(*intersect_with_line_func)(void*, const world_line* const, float* const t);
-typedef material_t(*material_getter_func)(void*, const world_point);
+typedef intersection_result(*intersect_with_line_func)(void*, const world_line* const, real_t* const t);
+//  Footprint is the width of the ray cone on the surface at the point, already stretched by 1 / cos of
+//  the incidence angle, it lets materials pick a texture level
+typedef material_t(*material_getter_func)(void*, const world_point, const real_t footprint);
+//  Geometric normal at a surface point, may be 0 for materials that ignore the footprint
+typedef world_vector(*normal_getter_func)(void*, const world_point);
 typedef void(*destroy_instance_func)(void*);
 typedef struct
 {
 	void* instance;
 	intersect_with_line_func intersect_func;
 	material_getter_func material_func;
+	normal_getter_func normal_func;
 	destroy_instance_func destroy_func;
 } graphic_object;
 
+real_t surface_footprint(const graphic_object* const object, const world_point point, const world_vector dir, const real_t footprint);
+
 typedef struct _scene_t scene_t;
 
-typedef float (*intensity_getter_func)(void* instance, scene_t* scene, const world_point point, const material_t material, const world_point view_vector);
+typedef real_t (*intensity_getter_func)(void* instance, scene_t* scene, const world_point point, const material_t material, const world_point view_vector);
 typedef void(*destroy_light_instance_func)(void*);
 typedef struct
 {
@@ -97,9 +137,88 @@ typedef struct
 	destroy_light_instance_func destroy_func;
 } light_object;
 
-light_object create_ambient_light(float intensity);
-light_object create_point_light(const world_point location, float intensity);
-light_object create_directed_light(const world_point direction, float intensity);
+#define TEXTURE_TILE_SIZE 8
+#define TEXTURE_MAX_LEVELS 16
+
+//  Texels of a level are stored tile by tile, TEXTURE_TILE_SIZE x TEXTURE_TILE_SIZE texels each,
+//  so a bilinear lookup touches at most four neighbouring tiles.
+typedef struct
+{
+    int width;
+    int height;
+    int tiles_per_row;
+    size_t offset;
+} texture_level;
+
+typedef struct
+{
+    color_t* texels;
+    size_t texels_count;
+    int levels_count;
+    texture_level levels[TEXTURE_MAX_LEVELS];
+    void* mapping;
+} texture_t;
+
+int create_texture(texture_t* texture, const color_t* pixels, const int width, const int height);
+int load_ppm_texture(texture_t* texture, const char* path);
+int load_raw_texture(texture_t* texture, const char* path, const int width, const int height);
+int save_texture(const texture_t* const texture, const char* path);
+int map_texture(texture_t* texture, const char* path);
+void destroy_texture(texture_t* texture);
+//  Texture coordinates wrap around, footprint is given in the same units as them
+color_t sample_texture(const texture_t* const texture, real_t u, real_t v, const real_t footprint);
+
+graphic_object create_textured_sphere(const world_sphere sphere, const texture_t* const texture, const int specularity, const real_t reflectivity);
+graphic_object create_textured_plane(const world_plane plane, const texture_t* const texture, const real_t tile_size, const int specularity, const real_t reflectivity);
+graphic_object create_textured_poly(const world_point* vertices, const int count, const texture_t* const texture, const int specularity, const real_t reflectivity);
+
+light_object create_ambient_light(real_t intensity);
+light_object create_point_light(const world_point location, real_t intensity);
+light_object create_directed_light(const world_point direction, real_t intensity);
+
+//  Flattened bounding volume hierarchy. Inner nodes keep their children at first and first + 1,
+//  leaves reference count items starting at first in indices.
+typedef struct
+{
+    world_box bounds;
+    int first;
+    int count;
+} bvh_node;
+
+typedef struct
+{
+    bvh_node* nodes;
+    int nodes_count;
+    int* indices;
+    int items_count;
+} bvh_tree;
+
+//  Called for every item of a leaf pierced by the line, returns the new upper bound of the search range
+typedef real_t(*bvh_leaf_func)(void* context, const int item, const world_line* const line, const real_t tmin, const real_t tmax);
+
+void build_bvh(bvh_tree* tree, const world_box* boxes, const int count);
+void destroy_bvh(bvh_tree* tree);
+void traverse_bvh(const bvh_tree* const tree, const world_line* const line, const real_t tmin, real_t tmax, bvh_leaf_func leaf_func, void* context);
+
+//  Shared geometry in its own space. Parts must be bounded, the prototype owns and destroys them.
+typedef struct
+{
+    graphic_object* parts;
+    int parts_count;
+    bvh_tree parts_tree;
+    world_box bounds;
+} graphic_prototype;
+
+//  Lightweight placement of a prototype, only the world to prototype space transform is kept
+typedef struct
+{
+    const graphic_prototype* prototype;
+    world_transform to_local;
+} graphic_instance;
+
+void init_prototype(graphic_prototype* prototype, graphic_object* parts, const world_box* parts_bounds, const int parts_count);
+void destroy_prototype(graphic_prototype* prototype);
+graphic_instance create_instance(const graphic_prototype* const prototype, const world_transform* const to_world);
 
 struct _scene_t
 {
@@ -107,12 +226,56 @@ struct _scene_t
     int lights_count;
 	graphic_object* graphical_objects;
     int objects_count;
+	graphic_instance* instances;
+    int instances_count;
+    bvh_tree instances_tree;
 };
 
 void init_scene(scene_t* scene);
 void destroy_scene(scene_t* scene);
 
+void build_instances_tree(scene_t* scene);
+int intersect_line_with_instances(const scene_t* const scene, const world_line* const line, const real_t tmin, const real_t tmax, int* const instance_index, int* const part_index, real_t* const t);
+material_t instance_material(const graphic_instance* const instance, const int part_index, const world_line* const line, const real_t t, const real_t footprint);
+
+#define RAY_TRACER_REFLECTION_DEPTH 2
+
+//  Intersection found by one ray of a pixel path, object_index is -1 when the ray escaped the scene
+typedef struct
+{
+    world_line ray;
+    int object_index;
+    int instance_index;
+    real_t t;
+    world_point position;
+} cached_hit;
+
+//  Primary ray followed by its reflections, hits_count is 0 when the pixel has to be traced again
+typedef struct
+{
+    cached_hit hits[RAY_TRACER_REFLECTION_DEPTH + 1];
+    int hits_count;
+} cached_path;
+
+//  Hits of the previous render, so that material and light edits only run shading again.
+//  Geometry edits must invalidate the old and new bounds of the changed object, adding or removing
+//  objects shifts their indices and requires clearing the whole cache.
+typedef struct
+{
+    cached_path* paths;
+    int width;
+    int height;
+} render_cache;
+
+int create_render_cache(render_cache* cache, const int canvas_width, const int canvas_height);
+void destroy_render_cache(render_cache* cache);
+void clear_render_cache(render_cache* cache);
+//  Returns the number of pixels whose path crosses the box
+int invalidate_render_cache(render_cache* cache, const world_box* const bounds);
 
+void trace_scene(scene_t* scene, const int canvas_width, const int canvas_height, put_pixel_callback put_pixel);
+//  Returns the number of pixels whose rays were intersected with the scene again instead of taken from the cache
+int trace_scene_cached(scene_t* scene, render_cache* cache, put_pixel_callback put_pixel);
 void trace(const int canvas_width, const int canvas_height, put_pixel_callback put_pixel);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,96 @@
+#ifndef RAY_TRACER_REAL_H_INCLUDED__
+#define RAY_TRACER_REAL_H_INCLUDED__
+
+#include <float.h>
+#include <math.h>
+
+//  Scalar type of the tracer. Float by default, Q16.16 fixed point when RAY_TRACER_FIXED_POINT is defined.
+//  REAL() is meant for literals only, so that no floating point code is emitted for fixed point builds.
+#ifdef RAY_TRACER_FIXED_POINT
+
+#include <stdint.h>
+
+typedef int32_t real_t;
+
+#define REAL_FRACTION_BITS 16
+#define REAL_ONE ((real_t)1 << REAL_FRACTION_BITS)
+#define REAL_MAX ((real_t)INT32_MAX)
+#define REAL(X) ((real_t)((X) * 65536.0 + ((X) < 0 ? -0.5 : 0.5)))
+
+#define real_from_int(X) ((real_t)(X) * REAL_ONE)
+#define real_round(X) ((long)(((int64_t)(X) + (REAL_ONE >> 1)) >> REAL_FRACTION_BITS))
+#define real_abs(X) ((X) < 0 ? -(X) : (X))
+#define real_trunc(X) ((X) < 0 ? -(-(X) & ~(REAL_ONE - 1)) : ((X) & ~(REAL_ONE - 1)))
+#define real_floor(X) ((X) & ~(REAL_ONE - 1))
+#define real_to_int(X) ((int)((X) >> REAL_FRACTION_BITS))
+#define real_to_float(X) ((float)(X) / 65536.0f)
+#define real_from_float(X) ((real_t)lroundf((X) * 65536.0f))
+
+static inline real_t real_saturate(const int64_t value)
+{
+    if (value > INT32_MAX)
+        return INT32_MAX;
+    if (value < -INT32_MAX)
+        return -INT32_MAX;
+    return (real_t)value;
+}
+
+//  Sums of saturated values are computed wide and saturated once, plain int32 sums would overflow
+static inline real_t real_add(const real_t a, const real_t b)
+{
+    return real_saturate((int64_t)a + b);
+}
+
+static inline real_t real_sub(const real_t a, const real_t b)
+{
+    return real_saturate((int64_t)a - b);
+}
+
+static inline real_t real_mul(const real_t a, const real_t b)
+{
+    return real_saturate(((int64_t)a * b) >> REAL_FRACTION_BITS);
+}
+
+static inline real_t real_div(const real_t a, const real_t b)
+{
+    if (b == 0)
+        return a < 0 ? -REAL_MAX : REAL_MAX;
+    return real_saturate(((int64_t)a * REAL_ONE) / b);
+}
+
+real_t real_sqrt(const real_t a);
+real_t real_sqrt_wide(const int64_t value);
+real_t real_pow_int(const real_t base, int exponent);
+real_t real_sin(real_t angle);
+real_t real_cos(const real_t angle);
+real_t real_atan2(const real_t y, const real_t x);
+
+#else
+
+typedef float real_t;
+
+#define REAL_ONE 1.0f
+#define REAL_MAX FLT_MAX
+#define REAL(X) ((real_t)(X))
+
+#define real_from_int(X) ((real_t)(X))
+#define real_round(X) lroundf(X)
+#define real_abs(X) ((real_t)fabs(X))
+#define real_trunc(X) truncf(X)
+#define real_floor(X) floorf(X)
+#define real_to_int(X) ((int)floorf(X))
+#define real_to_float(X) (X)
+#define real_from_float(X) (X)
+#define real_add(A, B) ((A) + (B))
+#define real_sub(A, B) ((A) - (B))
+#define real_mul(A, B) ((A) * (B))
+#define real_div(A, B) ((A) / (B))
+#define real_sqrt(X) sqrtf(X)
+#define real_pow_int(X, N) ((real_t)pow((X), (real_t)(N)))
+#define real_sin(X) sinf(X)
+#define real_cos(X) cosf(X)
+#define real_atan2(Y, X) atan2f((Y), (X))
+
+#endif
+
+#endif
@@ -0,0 +1,129 @@
+#include "ray_tracer.h"
+
+#define BVH_LEAF_SIZE 4
+#define BVH_STACK_SIZE 64
+
+static real_t box_centroid(const world_box* const box, const int axis)
+{
+    return real_mul(real_add(box->min.coords[axis], box->max.coords[axis]), REAL(0.5));
+}
+
+static void select_median(int* const indices, const world_box* boxes, const int count, const int median, const int axis)
+{
+    int lo = 0;
+    int hi = count - 1;
+    while (lo < hi)
+    {
+        const real_t pivot = box_centroid(&boxes[indices[(lo + hi) / 2]], axis);
+        int i = lo;
+        int j = hi;
+        while (i <= j)
+        {
+            while (box_centroid(&boxes[indices[i]], axis) < pivot)
+                ++i;
+            while (pivot < box_centroid(&boxes[indices[j]], axis))
+                --j;
+            if (i <= j)
+            {
+                const int temp = indices[i];
+                indices[i] = indices[j];
+                indices[j] = temp;
+                ++i;
+                --j;
+            }
+        }
+        if (median <= j)
+            hi = j;
+        else if (i <= median)
+            lo = i;
+        else
+            break;
+    }
+}
+
+static void build_node(bvh_tree* tree, const world_box* boxes, const int node_index, const int first, const int count)
+{
+    bvh_node* const node = &tree->nodes[node_index];
+    world_box centroids = empty_box();
+    node->bounds = empty_box();
+    for (int i = first; i < first + count; ++i)
+    {
+        const world_box* const box = &boxes[tree->indices[i]];
+        world_box centroid_box;
+        for (int axis = 0; axis < 3; ++axis)
+            centroid_box.min.coords[axis] = box_centroid(box, axis);
+        centroid_box.max = centroid_box.min;
+        node->bounds = merge_boxes(node->bounds, *box);
+        centroids = merge_boxes(centroids, centroid_box);
+    }
+    node->first = first;
+    node->count = count;
+    if (count <= BVH_LEAF_SIZE)
+        return;
+    int split_axis = 0;
+    for (int axis = 1; axis < 3; ++axis)
+    {
+        if (real_sub(centroids.max.coords[axis], centroids.min.coords[axis]) > real_sub(centroids.max.coords[split_axis], centroids.min.coords[split_axis]))
+            split_axis = axis;
+    }
+    if (centroids.max.coords[split_axis] <= centroids.min.coords[split_axis])
+        return;
+    const int half = count / 2;
+    select_median(tree->indices + first, boxes, count, half, split_axis);
+    const int left = tree->nodes_count;
+    tree->nodes_count += 2;
+    node->first = left;
+    node->count = 0;
+    build_node(tree, boxes, left, first, half);
+    build_node(tree, boxes, left + 1, first + half, count - half);
+}
+
+void build_bvh(bvh_tree* tree, const world_box* boxes, const int count)
+{
+    tree->nodes = 0;
+    tree->nodes_count = 0;
+    tree->indices = 0;
+    tree->items_count = 0;
+    if (!boxes || count <= 0)
+        return;
+    tree->nodes = malloc(sizeof(bvh_node) * (2 * count - 1));
+    tree->indices = malloc(sizeof(int) * count);
+    tree->items_count = count;
+    for (int i = 0; i < count; ++i)
+        tree->indices[i] = i;
+    tree->nodes_count = 1;
+    build_node(tree, boxes, 0, 0, count);
+}
+
+void destroy_bvh(bvh_tree* tree)
+{
+    free(tree->nodes);
+    free(tree->indices);
+    tree->nodes = 0;
+    tree->nodes_count = 0;
+    tree->indices = 0;
+    tree->items_count = 0;
+}
+
+void traverse_bvh(const bvh_tree* const tree, const world_line* const line, const real_t tmin, real_t tmax, bvh_leaf_func leaf_func, void* context)
+{
+    if (tree->nodes_count == 0)
+        return;
+    int stack[BVH_STACK_SIZE];
+    int stack_size = 0;
+    stack[stack_size++] = 0;
+    while (stack_size > 0)
+    {
+        const bvh_node* const node = &tree->nodes[stack[--stack_size]];
+        if (!intersect_line_with_box(line, &node->bounds, tmin, tmax))
+            continue;
+        if (node->count == 0)
+        {
+            stack[stack_size++] = node->first + 1;
+            stack[stack_size++] = node->first;
+            continue;
+        }
+        for (int i = node->first; i < node->first + node->count; ++i)
+            tmax = leaf_func(context, tree->indices[i], line, tmin, tmax);
+    }
+}
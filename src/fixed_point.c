@@ -0,0 +1,93 @@
+#include "ray_tracer_real.h"
+
+#ifdef RAY_TRACER_FIXED_POINT
+
+#define REAL_PI REAL(3.14159265358979)
+#define REAL_HALF_PI REAL(1.57079632679490)
+#define REAL_TWO_PI REAL(6.28318530717959)
+
+real_t real_sqrt(const real_t a)
+{
+    return real_sqrt_wide((int64_t)a * REAL_ONE);
+}
+
+real_t real_sqrt_wide(const int64_t value)
+{
+    if (value <= 0)
+        return 0;
+    //  Integer square root of a Q32.32 value is its Q16.16 square root
+    uint64_t rest = (uint64_t)value;
+    uint64_t root = 0;
+    uint64_t bit = (uint64_t)1 << 62;
+    while (bit > rest)
+        bit >>= 2;
+    while (bit)
+    {
+        if (rest >= root + bit)
+        {
+            rest -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+        {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return real_saturate((int64_t)root);
+}
+
+real_t real_pow_int(const real_t base, int exponent)
+{
+    real_t res = REAL_ONE;
+    real_t factor = base;
+    while (exponent > 0)
+    {
+        if (exponent & 1)
+            res = real_mul(res, factor);
+        factor = real_mul(factor, factor);
+        exponent >>= 1;
+    }
+    return res;
+}
+
+real_t real_sin(real_t angle)
+{
+    angle %= REAL_TWO_PI;
+    if (angle > REAL_PI)
+        angle -= REAL_TWO_PI;
+    else if (angle < -REAL_PI)
+        angle += REAL_TWO_PI;
+    if (angle > REAL_HALF_PI)
+        angle = REAL_PI - angle;
+    else if (angle < -REAL_HALF_PI)
+        angle = -REAL_PI - angle;
+    //  Taylor series up to x^7 is accurate to a few fixed point units on [-pi/2, pi/2]
+    const real_t square = real_mul(angle, angle);
+    real_t res = REAL_ONE - real_div(square, REAL(42));
+    res = REAL_ONE - real_mul(real_div(square, REAL(20)), res);
+    res = REAL_ONE - real_mul(real_div(square, REAL(6)), res);
+    return real_mul(angle, res);
+}
+
+real_t real_cos(const real_t angle)
+{
+    return real_sin(angle + REAL_HALF_PI);
+}
+
+real_t real_atan2(const real_t y, const real_t x)
+{
+    if (x == 0 && y == 0)
+        return 0;
+    //  atan(z) ~ pi/4 * z + 0.273 * z * (1 - |z|) on [-1, 1], within 0.004 radian
+    const int swapped = real_abs(y) > real_abs(x);
+    const real_t z = swapped ? real_div(x, y) : real_div(y, x);
+    real_t res = real_mul(z, REAL(0.78539816) + real_mul(REAL(0.273), REAL_ONE - real_abs(z)));
+    if (swapped)
+        res = ((y < 0) != (x < 0) ? -REAL_HALF_PI : REAL_HALF_PI) - res;
+    if (x < 0)
+        res += y < 0 ? -REAL_PI : REAL_PI;
+    return res;
+}
+
+#endif
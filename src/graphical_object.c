@@ -11,27 +11,27 @@ typedef struct
 	world_sphere sphere;
 	color_t color;
 	int specularity;
-	float reflectivity;
+	real_t reflectivity;
 } SphereObject;
 
 
-static intersection_result intersect_sphere_object(void* instance, const world_line* const line, float* const roots)
+static intersection_result intersect_sphere_object(void* instance, const world_line* const line, real_t* const roots)
 {
 	SphereObject* sphere_object = (SphereObject*)(instance);
 	return intersect_line_with_sphere(line, &sphere_object->sphere, roots);
 }
 
-static material_t sphere_material_getter(void* instance, const world_point point)
+static material_t sphere_material_getter(void* instance, const world_point point, const real_t footprint)
 {
 	SphereObject* sphere_object = (SphereObject*)(instance);
 	material_t material;
 	color_t top_color = {{ 255, 247, 196 }};
 	color_t bottom_color = {{ 207, 28, 83 }};
-	float t = (sphere_object->sphere.center.coords[1] + sphere_object->sphere.radius - point.coords[1]) / 2 / sphere_object->sphere.radius;
+	real_t t = real_div(real_div(sphere_object->sphere.center.coords[1] + sphere_object->sphere.radius - point.coords[1], REAL(2)), sphere_object->sphere.radius);
 	material.color = lerp_color(top_color, bottom_color, t);
 	material.normal = normalize(sub(point, sphere_object->sphere.center));
 	
-	if (t < 0.8)
+	if (t < REAL(0.8))
 	{
 		material.specularity = -1;
 		material.reflectivity = 0;
@@ -49,7 +49,7 @@ static void destroy_base_object(void* base_graphical_object)
 	free(base_graphical_object);
 }
 
-static graphic_object create_sphere_object(world_point center, float radius, color_t color, int specularity, float reflectivity)
+static graphic_object create_sphere_object(world_point center, real_t radius, color_t color, int specularity, real_t reflectivity)
 {
 	graphic_object res;
 	SphereObject* sphere_object = malloc(sizeof(SphereObject));
@@ -61,6 +61,7 @@ static graphic_object create_sphere_object(world_point center, float radius, col
 	res.instance = sphere_object;
 	res.intersect_func = intersect_sphere_object;
 	res.material_func = sphere_material_getter;
+	res.normal_func = 0;
 	res.destroy_func = destroy_base_object;
 	return res;
 }
@@ -71,24 +72,24 @@ typedef struct
 	color_t color;
 } earth_object_t;
 
-static intersection_result intersect_earth_object(void* instance, const world_line* const line, float* const roots)
+static intersection_result intersect_earth_object(void* instance, const world_line* const line, real_t* const roots)
 {
 	earth_object_t* earth = (earth_object_t*)(instance);
 	return intersect_line_with_plane(line, &earth->plane, roots);
 }
 
-static material_t earth_material_getter(void* instance, const world_point point)
+static material_t earth_material_getter(void* instance, const world_point point, const real_t footprint)
 {
-	const float line_width = 0.02f;
-	const float quad_width = 0.2f;
-	const float width_channel = (float)fabs(point.coords[0]);
-	const float height_channel = point.coords[2];
-	float relative_w = width_channel / (quad_width + line_width);
-	relative_w -= truncf(relative_w);
-	float relative_h = height_channel / (quad_width + line_width);
-	relative_h -= truncf(relative_h);
+	const real_t line_width = REAL(0.02);
+	const real_t quad_width = REAL(0.2);
+	const real_t width_channel = real_abs(point.coords[0]);
+	const real_t height_channel = point.coords[2];
+	real_t relative_w = real_div(width_channel, quad_width + line_width);
+	relative_w -= real_trunc(relative_w);
+	real_t relative_h = real_div(height_channel, quad_width + line_width);
+	relative_h -= real_trunc(relative_h);
 	material_t material;
-	if (relative_h > (line_width / (quad_width + line_width)) && relative_w > (line_width / (quad_width + line_width)))
+	if (relative_h > real_div(line_width, quad_width + line_width) && relative_w > real_div(line_width, quad_width + line_width))
 	{
 		//	cell content
 		color_t cell_color = {{ 18, 0, 98 }};
@@ -109,7 +110,7 @@ static material_t earth_material_getter(void* instance, const world_point point)
 	earth_object_t* earth = (earth_object_t*)(instance);
 	material.normal = earth->plane.normal;
 	material.specularity = 500;
-	material.reflectivity = 0.5f;
+	material.reflectivity = REAL(0.5);
 	return material;
 }
 
@@ -120,12 +121,13 @@ static graphic_object create_earth_object()
 	earth->color.channels[0] = 150;
 	earth->color.channels[1] = 150;
 	earth->color.channels[2] = 150;
-	earth->plane.D = 0.5;
+	earth->plane.D = REAL(0.5);
 	zero(&earth->plane.normal);
-	earth->plane.normal.coords[1] = 1.0f;
+	earth->plane.normal.coords[1] = REAL_ONE;
 	res.instance = earth;
 	res.intersect_func = intersect_earth_object;
 	res.material_func = earth_material_getter;
+	res.normal_func = 0;
 	res.destroy_func = destroy_base_object;
 	return res;
 }
@@ -136,21 +138,21 @@ typedef struct
 	world_point countour[MOUNTAINS_VERTICES_COUNT];
 } mountains_t;
 
-static intersection_result intersect_mountains_object(void* instance, const world_line* const line, float* const roots)
+static intersection_result intersect_mountains_object(void* instance, const world_line* const line, real_t* const roots)
 {
 	mountains_t* mountains = (mountains_t*)(instance);
 	return intersect_line_with_poly(line, mountains->countour, MOUNTAINS_VERTICES_COUNT, roots);
 }
 
-static material_t mountains_material_getter(void* instance, const world_point point)
+static material_t mountains_material_getter(void* instance, const world_point point, const real_t footprint)
 {
 	material_t material;
 	color_t color = {{ 30, 0, 71 }};
 	material.color = color;
 	zero(&material.normal);
-	material.normal.coords[2] = -1.0f;
+	material.normal.coords[2] = -REAL_ONE;
 	material.specularity = -1;
-	material.reflectivity = 0.5f;
+	material.reflectivity = REAL(0.5);
 	return material;
 }
 
@@ -161,17 +163,18 @@ static graphic_object create_mountains()
 	res.instance = mountains;
 	res.intersect_func = intersect_mountains_object;
 	res.material_func = mountains_material_getter;
+	res.normal_func = 0;
 	res.destroy_func = destroy_base_object;
 	
 	//	Countour initialization
-	float z_coord = 10;
-	mountains->countour[0].coords[0] = -10.0f; mountains->countour[0].coords[1] = -0.51f; mountains->countour[0].coords[2] = z_coord;
-	mountains->countour[1].coords[0] = 10.0f; mountains->countour[1].coords[1] = -0.51f; mountains->countour[1].coords[2] = z_coord;
-	mountains->countour[2].coords[0] = 5.0f; mountains->countour[2].coords[1] = 0.7f; mountains->countour[2].coords[2] = z_coord;
-	mountains->countour[3].coords[0] = 1.6f; mountains->countour[3].coords[1] = -0.1f; mountains->countour[3].coords[2] = z_coord;
-	mountains->countour[4].coords[0] = 0.3f; mountains->countour[4].coords[1] = 0.1f; mountains->countour[4].coords[2] = z_coord;
-	mountains->countour[5].coords[0] = -1.1f; mountains->countour[5].coords[1] = -0.1f; mountains->countour[5].coords[2] = z_coord;
-	mountains->countour[6].coords[0] = -10.0f; mountains->countour[6].coords[1] = -0.3f; mountains->countour[6].coords[2] = z_coord;
+	real_t z_coord = REAL(10);
+	mountains->countour[0].coords[0] = REAL(-10.0); mountains->countour[0].coords[1] = REAL(-0.51); mountains->countour[0].coords[2] = z_coord;
+	mountains->countour[1].coords[0] = REAL(10.0); mountains->countour[1].coords[1] = REAL(-0.51); mountains->countour[1].coords[2] = z_coord;
+	mountains->countour[2].coords[0] = REAL(5.0); mountains->countour[2].coords[1] = REAL(0.7); mountains->countour[2].coords[2] = z_coord;
+	mountains->countour[3].coords[0] = REAL(1.6); mountains->countour[3].coords[1] = REAL(-0.1); mountains->countour[3].coords[2] = z_coord;
+	mountains->countour[4].coords[0] = REAL(0.3); mountains->countour[4].coords[1] = REAL(0.1); mountains->countour[4].coords[2] = z_coord;
+	mountains->countour[5].coords[0] = REAL(-1.1); mountains->countour[5].coords[1] = REAL(-0.1); mountains->countour[5].coords[2] = z_coord;
+	mountains->countour[6].coords[0] = REAL(-10.0); mountains->countour[6].coords[1] = REAL(-0.3); mountains->countour[6].coords[2] = z_coord;
 
 	return res;
 }
@@ -182,22 +185,25 @@ void init_scene(scene_t* scene)
 	scene->lights_count = LIGHT_OBJECTS_COUNT;
 	scene->graphical_objects = graphical_objects;
 	scene->objects_count = GRAPHICAL_OBJECTS_COUNT;
+	scene->instances = 0;
+	scene->instances_count = 0;
+	build_bvh(&scene->instances_tree, 0, 0);
 
 	{
-		light_objects[0] = create_ambient_light(0.2f);
+		light_objects[0] = create_ambient_light(REAL(0.2));
 	}
 	{
 		world_point location;
 		zero(&location);
 		location.coords[0] = 0;
-		location.coords[1] = 2;
-		location.coords[2] = 7;
-		light_objects[1] = create_point_light(location, 0.8f);
+		location.coords[1] = REAL(2);
+		location.coords[2] = REAL(7);
+		light_objects[1] = create_point_light(location, REAL(0.8));
 	}
 	{
-		world_point sphere_center = {{ 0.0, 0.5f, 14.0f }};
+		world_point sphere_center = {{ REAL(0.0), REAL(0.5), REAL(14.0) }};
 		color_t sphere_color = {{ 187, 164, 62 }};
-		graphical_objects[0] = create_sphere_object(sphere_center, 1.5, sphere_color, 500, 0.2f);
+		graphical_objects[0] = create_sphere_object(sphere_center, REAL(1.5), sphere_color, 500, REAL(0.2));
 	}
 	{
 		graphical_objects[1] = create_earth_object();
@@ -213,6 +219,9 @@ void destroy_scene(scene_t* scene)
 	scene->graphical_objects = 0;
 	scene->lights_count = 0;
 	scene->light_objects = 0;
+	scene->instances_count = 0;
+	scene->instances = 0;
+	destroy_bvh(&scene->instances_tree);
 	for (int i = 0; i < LIGHT_OBJECTS_COUNT; ++i)
 	{
 		light_objects[i].destroy_func(light_objects[i].instance);
@@ -0,0 +1,136 @@
+#include "ray_tracer.h"
+
+typedef struct
+{
+    const graphic_prototype* prototype;
+    int part_index;
+    real_t t;
+} prototype_hit;
+
+typedef struct
+{
+    const scene_t* scene;
+    int instance_index;
+    int part_index;
+    real_t t;
+} instance_hit;
+
+static real_t intersect_prototype_part(void* context, const int item, const world_line* const line, const real_t tmin, const real_t tmax)
+{
+    prototype_hit* const hit = (prototype_hit*)context;
+    const graphic_object* const part = &hit->prototype->parts[item];
+    real_t roots[2];
+    const int roots_count = (int)part->intersect_func(part->instance, line, roots);
+    real_t nearest = tmax;
+    for (int root_index = 0; root_index < roots_count; ++root_index)
+    {
+        if (roots[root_index] < tmin || nearest < roots[root_index])
+            continue;
+        nearest = roots[root_index];
+        hit->part_index = item;
+        hit->t = nearest;
+    }
+    return nearest;
+}
+
+static real_t intersect_instance(void* context, const int item, const world_line* const line, const real_t tmin, const real_t tmax)
+{
+    instance_hit* const hit = (instance_hit*)context;
+    const graphic_instance* const instance = &hit->scene->instances[item];
+    if (!instance->prototype)
+        return tmax;
+    //  The direction is not normalized, so the line parameter is the same in both spaces
+    world_line local_line;
+    local_line.origin = transform_point(&instance->to_local, line->origin);
+    local_line.dir = transform_vector(&instance->to_local, line->dir);
+    prototype_hit part_hit;
+    part_hit.prototype = instance->prototype;
+    part_hit.part_index = -1;
+    traverse_bvh(&instance->prototype->parts_tree, &local_line, tmin, tmax, intersect_prototype_part, &part_hit);
+    if (part_hit.part_index == -1)
+        return tmax;
+    hit->instance_index = item;
+    hit->part_index = part_hit.part_index;
+    hit->t = part_hit.t;
+    return part_hit.t;
+}
+
+void init_prototype(graphic_prototype* prototype, graphic_object* parts, const world_box* parts_bounds, const int parts_count)
+{
+    prototype->parts = malloc(sizeof(graphic_object) * parts_count);
+    prototype->parts_count = parts_count;
+    prototype->bounds = empty_box();
+    for (int i = 0; i < parts_count; ++i)
+    {
+        prototype->parts[i] = parts[i];
+        prototype->bounds = merge_boxes(prototype->bounds, parts_bounds[i]);
+    }
+    build_bvh(&prototype->parts_tree, parts_bounds, parts_count);
+}
+
+void destroy_prototype(graphic_prototype* prototype)
+{
+    for (int i = 0; i < prototype->parts_count; ++i)
+    {
+        prototype->parts[i].destroy_func(prototype->parts[i].instance);
+    }
+    free(prototype->parts);
+    prototype->parts = 0;
+    prototype->parts_count = 0;
+    destroy_bvh(&prototype->parts_tree);
+}
+
+graphic_instance create_instance(const graphic_prototype* const prototype, const world_transform* const to_world)
+{
+    graphic_instance instance;
+    instance.prototype = invert_transform(to_world, &instance.to_local) ? prototype : 0;
+    return instance;
+}
+
+void build_instances_tree(scene_t* scene)
+{
+    destroy_bvh(&scene->instances_tree);
+    if (scene->instances_count <= 0)
+        return;
+    world_box* const boxes = malloc(sizeof(world_box) * scene->instances_count);
+    for (int i = 0; i < scene->instances_count; ++i)
+    {
+        const graphic_instance* const instance = &scene->instances[i];
+        world_transform to_world;
+        if (!instance->prototype || !invert_transform(&instance->to_local, &to_world))
+        {
+            zero(&boxes[i].min);
+            boxes[i].max = boxes[i].min;
+            continue;
+        }
+        boxes[i] = transform_box(&to_world, instance->prototype->bounds);
+    }
+    build_bvh(&scene->instances_tree, boxes, scene->instances_count);
+    free(boxes);
+}
+
+int intersect_line_with_instances(const scene_t* const scene, const world_line* const line, const real_t tmin, const real_t tmax, int* const instance_index, int* const part_index, real_t* const t)
+{
+    instance_hit hit;
+    hit.scene = scene;
+    hit.instance_index = -1;
+    hit.part_index = -1;
+    traverse_bvh(&scene->instances_tree, line, tmin, tmax, intersect_instance, &hit);
+    if (hit.instance_index == -1)
+        return 0;
+    *instance_index = hit.instance_index;
+    *part_index = hit.part_index;
+    *t = hit.t;
+    return 1;
+}
+
+material_t instance_material(const graphic_instance* const instance, const int part_index, const world_line* const line, const real_t t, const real_t footprint)
+{
+    const graphic_object* const part = &instance->prototype->parts[part_index];
+    const world_vector local_dir = transform_vector(&instance->to_local, line->dir);
+    const real_t local_footprint = real_div(real_mul(footprint, length(local_dir)), length(line->dir));
+    const world_point local_point = transform_point(&instance->to_local, line_point(*line, t));
+    material_t material = part->material_func(part->instance, local_point, surface_footprint(part, local_point, local_dir, local_footprint));
+    material.normal = normalize(transform_normal(&instance->to_local, material.normal));
+    return material;
+}
@@ -1,13 +1,16 @@
 #include "ray_tracer.h"
-#include <float.h>
 
-static float view_port_w = 1;
-static float view_port_h = 1;
+static real_t view_port_w = REAL(1);
+static real_t view_port_h = REAL(1);
+#ifdef RAY_TRACER_FIXED_POINT
+#define T_EPS REAL(0.002)
+#else
 #define T_EPS 0.00001f
+#endif
 
-static float  det(const float a11, const float a12, const float a21, const float a22)
+static real_t  det(const real_t a11, const real_t a12, const real_t a21, const real_t a22)
 {
-    return a11 * a22 - a12 * a21;
+    return real_sub(real_mul(a11, a22), real_mul(a12, a21));
 }
 
 void zero(world_point* const p)
@@ -22,42 +25,42 @@ void zero(world_point* const p)
 world_point sum(world_point const p1, world_point const p2)
 {
     world_point res;
-    res.coords[0] = p1.coords[0] + p2.coords[0];
-    res.coords[1] = p1.coords[1] + p2.coords[1];
-    res.coords[2] = p1.coords[2] + p2.coords[2];
+    res.coords[0] = real_add(p1.coords[0], p2.coords[0]);
+    res.coords[1] = real_add(p1.coords[1], p2.coords[1]);
+    res.coords[2] = real_add(p1.coords[2], p2.coords[2]);
     return res;
 }
 
 world_point sub(world_point const p1, world_point const p2)
 {
     world_point res;
-    res.coords[0] = p1.coords[0] - p2.coords[0];
-    res.coords[1] = p1.coords[1] - p2.coords[1];
-    res.coords[2] = p1.coords[2] - p2.coords[2];
+    res.coords[0] = real_sub(p1.coords[0], p2.coords[0]);
+    res.coords[1] = real_sub(p1.coords[1], p2.coords[1]);
+    res.coords[2] = real_sub(p1.coords[2], p2.coords[2]);
     return res;
 }
 
-color_t mul_color_by_factor(color_t const color, float factor)
+color_t mul_color_by_factor(color_t const color, real_t factor)
 {
     color_t res = color;
-    res.channels[0] = RAY_TRACER_MIN(255, (unsigned char)lroundf(res.channels[0] * factor));
-    res.channels[1] = RAY_TRACER_MIN(255, (unsigned char)lroundf(res.channels[1] * factor));
-    res.channels[2] = RAY_TRACER_MIN(255, (unsigned char)lroundf(res.channels[2] * factor));
+    res.channels[0] = RAY_TRACER_MIN(255, (unsigned char)real_round(real_mul(real_from_int(res.channels[0]), factor)));
+    res.channels[1] = RAY_TRACER_MIN(255, (unsigned char)real_round(real_mul(real_from_int(res.channels[1]), factor)));
+    res.channels[2] = RAY_TRACER_MIN(255, (unsigned char)real_round(real_mul(real_from_int(res.channels[2]), factor)));
     return res;
 }
 
-world_point mul_by_factor(world_point const p1, float factor)
+world_point mul_by_factor(world_point const p1, real_t factor)
 {
     world_point res;
-    res.coords[0] = p1.coords[0] * factor;
-    res.coords[1] = p1.coords[1] * factor;
-    res.coords[2] = p1.coords[2] * factor;
+    res.coords[0] = real_mul(p1.coords[0], factor);
+    res.coords[1] = real_mul(p1.coords[1], factor);
+    res.coords[2] = real_mul(p1.coords[2], factor);
     return res;
 }
 
 world_point reflect(world_point dir, world_point normal)
 {
-    return sub(mul_by_factor(normal, 2.0f * scalar_product(dir, normal)), dir);
+    return sub(mul_by_factor(normal, real_mul(REAL(2), scalar_product(dir, normal))), dir);
 }
 
 world_line create_line(world_point const origin, world_point const dir)
@@ -68,70 +71,82 @@ world_line create_line(world_point const origin, world_point const dir)
     return line;
 }
 
-float length(const world_point p)
+real_t length(const world_point p)
 {
-    return sqrtf(scalar_product(p, p));
+    return real_sqrt(scalar_product(p, p));
 }
 
 world_point normalize(const world_point p)
 {
-    return mul_by_factor(p, 1.0f / length(p));
+    return mul_by_factor(p, real_div(REAL_ONE, length(p)));
 }
 
-world_point line_point(world_line line, float t)
+world_point line_point(world_line line, real_t t)
 {
     world_point res = sum(line.origin, mul_by_factor(line.dir, t));
     return res;
 }
 
-float scalar_product(world_point const p1, world_point const p2)
+real_t scalar_product(world_point const p1, world_point const p2)
 {
-    const float* const arr1 = p1.coords;
-    const float* const arr2 = p2.coords;
-    return arr1[0] * arr2[0] + arr1[1] * arr2[1] + arr1[2] * arr2[2];
+    const real_t* const arr1 = p1.coords;
+    const real_t* const arr2 = p2.coords;
+    return real_add(real_add(real_mul(arr1[0], arr2[0]), real_mul(arr1[1], arr2[1])), real_mul(arr1[2], arr2[2]));
 }
 
-intersection_result intersect_line_with_sphere(const world_line* const line, world_sphere* const sphere, float* const t)
+world_vector cross_product(world_vector const v1, world_vector const v2)
+{
+    world_vector res;
+    res.coords[0] = real_sub(real_mul(v1.coords[1], v2.coords[2]), real_mul(v1.coords[2], v2.coords[1]));
+    res.coords[1] = real_sub(real_mul(v1.coords[2], v2.coords[0]), real_mul(v1.coords[0], v2.coords[2]));
+    res.coords[2] = real_sub(real_mul(v1.coords[0], v2.coords[1]), real_mul(v1.coords[1], v2.coords[0]));
+    return res;
+}
+
+intersection_result intersect_line_with_sphere(const world_line* const line, world_sphere* const sphere, real_t* const t)
 {
     if (!line || !sphere || !t)
         return NOT_INTERSECTED;
     const world_point delta = sub(line->origin, sphere->center);
-    return solve_quadratic(scalar_product(line->dir, line->dir), scalar_product(line->dir, mul_by_factor(delta, 2.0f)), scalar_product(delta, delta) - sphere->radius * sphere->radius, t);
+    return solve_quadratic(scalar_product(line->dir, line->dir), scalar_product(line->dir, mul_by_factor(delta, REAL(2))), real_sub(scalar_product(delta, delta), real_mul(sphere->radius, sphere->radius)), t);
 }
 
-intersection_result intersect_line_with_plane(const world_line* const line, world_plane* const plane, float* const t)
+intersection_result intersect_line_with_plane(const world_line* const line, world_plane* const plane, real_t* const t)
 {
-    const float a = scalar_product(line->dir, plane->normal);
-    const float b = scalar_product(line->origin, plane->normal) + plane->D;
-    if (a == 0.0f)
+    const real_t a = scalar_product(line->dir, plane->normal);
+    const real_t b = real_add(scalar_product(line->origin, plane->normal), plane->D);
+    if (a == 0)
     {
         if (a == b)
         {
-            *t = 0.0f;
+            *t = 0;
             return INTERSECTED;
         }
         return NOT_INTERSECTED;
     }
-    *t = -b / a;
+    *t = real_div(-b, a);
+    //  Nearly parallel lines meet the plane beyond any representable distance
+    if (real_abs(*t) >= REAL_MAX)
+        return NOT_INTERSECTED;
     return INTERSECTED;
 }
 
-intersection_result intersect_ray_with_line(const world_line* const ray, const world_line* const line2, float* const t)
+intersection_result intersect_ray_with_line(const world_line* const ray, const world_line* const line2, real_t* const t)
 {
     if (!ray || !line2)
         return NOT_INTERSECTED;
-    const float a11 = ray->dir.coords[0];
-    const float a12 = -line2->dir.coords[0];
-    const float b1 = line2->origin.coords[0] - ray->origin.coords[0];
-    const float a21 = ray->dir.coords[1];
-    const float a22 = -line2->dir.coords[1];
-    const float b2 = line2->origin.coords[1] - ray->origin.coords[1];
-    const float main_det = det(a11, a12, a21, a22);
-    if (main_det != 0.0f)
+    const real_t a11 = ray->dir.coords[0];
+    const real_t a12 = -line2->dir.coords[0];
+    const real_t b1 = real_sub(line2->origin.coords[0], ray->origin.coords[0]);
+    const real_t a21 = ray->dir.coords[1];
+    const real_t a22 = -line2->dir.coords[1];
+    const real_t b2 = real_sub(line2->origin.coords[1], ray->origin.coords[1]);
+    const real_t main_det = det(a11, a12, a21, a22);
+    if (main_det != 0)
     {
-        const float t1 = det(b1, a12, b2, a22) / main_det;
-        const float t2 = det(a11, b1, a21, b2) / main_det;
-        if (t1 >= 0.0f && 0.0f <= t2 && t2 <= 1.0f)
+        const real_t t1 = real_div(det(b1, a12, b2, a22), main_det);
+        const real_t t2 = real_div(det(a11, b1, a21, b2), main_det);
+        if (t1 >= 0 && 0 <= t2 && t2 <= REAL_ONE)
         {
             *t = t1;
             return INTERSECTED;
@@ -140,22 +155,22 @@ intersection_result intersect_ray_with_line(const world_line* const ray, const w
     return NOT_INTERSECTED;
 }
 
-intersection_result intersect_line_with_poly(const world_line* const line, const world_point* vertices, const int count, float* const t)
+intersection_result intersect_line_with_poly(const world_line* const line, const world_point* vertices, const int count, real_t* const t)
 {
     if (!vertices || count < 3)
         return 0;
     world_plane poly_plane;
     zero(&poly_plane.normal);
     poly_plane.D = -vertices[0].coords[2];
-    poly_plane.normal.coords[2] = 1.0f;
+    poly_plane.normal.coords[2] = REAL_ONE;
     if (!intersect_line_with_plane(line, &poly_plane, t))
         return NOT_INTERSECTED;
     world_line ray;
     zero(&ray.dir);
-    ray.dir.coords[0] = 0.6f;
-    ray.dir.coords[1] = 1.0f;
+    ray.dir.coords[0] = REAL(0.6);
+    ray.dir.coords[1] = REAL_ONE;
     ray.origin = line_point(*line, *t);
-    float temp_t = 0;
+    real_t temp_t = 0;
     int res = 0;
     for (int i = 0; i < count; ++i)
     {
@@ -167,49 +182,264 @@ intersection_result intersect_line_with_poly(const world_line* const line, const
     }
     return res % 2;
 }
-int solve_quadratic(float a, float b, float c, float* const t)
+int solve_quadratic(real_t a, real_t b, real_t c, real_t* const t)
 {
-    const float d = b * b - 4.0f * a * c;
+#ifdef RAY_TRACER_FIXED_POINT
+    //  A quarter of the discriminant is kept in Q32.32, squares of distant points do not fit Q16.16
+    const int64_t half_b = b / 2;
+    const int64_t d = half_b * half_b - (int64_t)a * c;
+    if (!t || d < 0 || a == 0)
+        return 0;
+    if (d == 0)
+    {
+        t[0] = real_saturate(-half_b * REAL_ONE / a);
+        return 1;
+    }
+    const int64_t sqrt_d = real_sqrt_wide(d);
+    t[0] = real_saturate((-half_b - sqrt_d) * REAL_ONE / a);
+    t[1] = real_saturate((-half_b + sqrt_d) * REAL_ONE / a);
+    return 2;
+#else
+    const real_t d = real_mul(b, b) - real_mul(real_mul(REAL(4), a), c);
     if (!t || d < 0)
         return 0;
     if (d == 0)
     {
-        t[0] = -b / 2.0f / a;
+        t[0] = real_div(real_div(-b, REAL(2)), a);
         return 1;
     }
-    const float sqrt_d = (float)sqrt(d);
-    t[0] = (-b - sqrt_d) / 2.0f / a;
-    t[1] = (-b + sqrt_d) / 2.0f / a;
+    const real_t sqrt_d = real_sqrt(d);
+    t[0] = real_div(real_div(-b - sqrt_d, REAL(2)), a);
+    t[1] = real_div(real_div(-b + sqrt_d, REAL(2)), a);
     return 2;
+#endif
 }
 
-color_t lerp_color(const color_t lhs, const color_t rhs, const float t)
+color_t lerp_color(const color_t lhs, const color_t rhs, const real_t t)
 {
     color_t res;
-    res.channels[0] = lhs.channels[0] + (unsigned char)lroundf(t * (rhs.channels[0] - lhs.channels[0]));
-    res.channels[1] = lhs.channels[1] + (unsigned char)lroundf(t * (rhs.channels[1] - lhs.channels[1]));
-    res.channels[2] = lhs.channels[2] + (unsigned char)lroundf(t * (rhs.channels[2] - lhs.channels[2]));
+    res.channels[0] = lhs.channels[0] + (unsigned char)real_round(real_mul(t, real_from_int(rhs.channels[0] - lhs.channels[0])));
+    res.channels[1] = lhs.channels[1] + (unsigned char)real_round(real_mul(t, real_from_int(rhs.channels[1] - lhs.channels[1])));
+    res.channels[2] = lhs.channels[2] + (unsigned char)real_round(real_mul(t, real_from_int(rhs.channels[2] - lhs.channels[2])));
+    return res;
+}
+
+world_box empty_box(void)
+{
+    world_box box;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        box.min.coords[axis] = REAL_MAX;
+        box.max.coords[axis] = -REAL_MAX;
+    }
+    return box;
+}
+
+world_box merge_boxes(const world_box lhs, const world_box rhs)
+{
+    world_box res;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        res.min.coords[axis] = RAY_TRACER_MIN(lhs.min.coords[axis], rhs.min.coords[axis]);
+        res.max.coords[axis] = RAY_TRACER_MAX(lhs.max.coords[axis], rhs.max.coords[axis]);
+    }
+    return res;
+}
+
+world_box sphere_box(const world_sphere* const sphere)
+{
+    world_box box;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        box.min.coords[axis] = real_sub(sphere->center.coords[axis], sphere->radius);
+        box.max.coords[axis] = real_add(sphere->center.coords[axis], sphere->radius);
+    }
+    return box;
+}
+
+world_box poly_box(const world_point* vertices, const int count)
+{
+    world_box box = empty_box();
+    for (int i = 0; i < count; ++i)
+    {
+        world_box vertex_box;
+        vertex_box.min = vertices[i];
+        vertex_box.max = vertices[i];
+        box = merge_boxes(box, vertex_box);
+    }
+    return box;
+}
+
+intersection_result intersect_line_with_box(const world_line* const line, const world_box* const box, real_t tmin, real_t tmax)
+{
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        const real_t origin = line->origin.coords[axis];
+        const real_t dir = line->dir.coords[axis];
+        if (dir == 0)
+        {
+            if (origin < box->min.coords[axis] || box->max.coords[axis] < origin)
+                return NOT_INTERSECTED;
+            continue;
+        }
+        const real_t t0 = real_div(real_sub(box->min.coords[axis], origin), dir);
+        const real_t t1 = real_div(real_sub(box->max.coords[axis], origin), dir);
+        tmin = RAY_TRACER_MAX(tmin, RAY_TRACER_MIN(t0, t1));
+        tmax = RAY_TRACER_MIN(tmax, RAY_TRACER_MAX(t0, t1));
+        if (tmax < tmin)
+            return NOT_INTERSECTED;
+    }
+    return INTERSECTED;
+}
+
+world_transform identity_transform(void)
+{
+    world_transform res;
+    for (int row = 0; row < 3; ++row)
+    {
+        for (int col = 0; col < 4; ++col)
+            res.m[row][col] = row == col ? REAL_ONE : 0;
+    }
+    return res;
+}
+
+world_transform translation_transform(const world_vector offset)
+{
+    world_transform res = identity_transform();
+    for (int row = 0; row < 3; ++row)
+        res.m[row][3] = offset.coords[row];
+    return res;
+}
+
+world_transform scale_transform(const world_vector factors)
+{
+    world_transform res = identity_transform();
+    for (int row = 0; row < 3; ++row)
+        res.m[row][row] = factors.coords[row];
+    return res;
+}
+
+world_transform rotation_transform(const world_vector axis, const real_t angle)
+{
+    const world_vector u = normalize(axis);
+    const real_t c = real_cos(angle);
+    const real_t s = real_sin(angle);
+    const real_t k = REAL_ONE - c;
+    world_transform res = identity_transform();
+    res.m[0][0] = c + real_mul(real_mul(u.coords[0], u.coords[0]), k);
+    res.m[0][1] = real_mul(real_mul(u.coords[0], u.coords[1]), k) - real_mul(u.coords[2], s);
+    res.m[0][2] = real_mul(real_mul(u.coords[0], u.coords[2]), k) + real_mul(u.coords[1], s);
+    res.m[1][0] = real_mul(real_mul(u.coords[1], u.coords[0]), k) + real_mul(u.coords[2], s);
+    res.m[1][1] = c + real_mul(real_mul(u.coords[1], u.coords[1]), k);
+    res.m[1][2] = real_mul(real_mul(u.coords[1], u.coords[2]), k) - real_mul(u.coords[0], s);
+    res.m[2][0] = real_mul(real_mul(u.coords[2], u.coords[0]), k) - real_mul(u.coords[1], s);
+    res.m[2][1] = real_mul(real_mul(u.coords[2], u.coords[1]), k) + real_mul(u.coords[0], s);
+    res.m[2][2] = c + real_mul(real_mul(u.coords[2], u.coords[2]), k);
+    return res;
+}
+
+world_transform compose_transforms(const world_transform* const outer, const world_transform* const inner)
+{
+    world_transform res;
+    for (int row = 0; row < 3; ++row)
+    {
+        for (int col = 0; col < 4; ++col)
+        {
+            res.m[row][col] = real_add(real_add(real_mul(outer->m[row][0], inner->m[0][col]), real_mul(outer->m[row][1], inner->m[1][col])), real_mul(outer->m[row][2], inner->m[2][col]));
+        }
+        res.m[row][3] = real_add(res.m[row][3], outer->m[row][3]);
+    }
+    return res;
+}
+
+int invert_transform(const world_transform* const transform, world_transform* const inverse)
+{
+    const real_t (*m)[4] = transform->m;
+    const real_t cofactors[3][3] = {
+        { det(m[1][1], m[1][2], m[2][1], m[2][2]), -det(m[1][0], m[1][2], m[2][0], m[2][2]), det(m[1][0], m[1][1], m[2][0], m[2][1]) },
+        { -det(m[0][1], m[0][2], m[2][1], m[2][2]), det(m[0][0], m[0][2], m[2][0], m[2][2]), -det(m[0][0], m[0][1], m[2][0], m[2][1]) },
+        { det(m[0][1], m[0][2], m[1][1], m[1][2]), -det(m[0][0], m[0][2], m[1][0], m[1][2]), det(m[0][0], m[0][1], m[1][0], m[1][1]) }
+    };
+    const real_t main_det = real_add(real_add(real_mul(m[0][0], cofactors[0][0]), real_mul(m[0][1], cofactors[0][1])), real_mul(m[0][2], cofactors[0][2]));
+    if (!inverse || main_det == 0)
+        return 0;
+    for (int row = 0; row < 3; ++row)
+    {
+        for (int col = 0; col < 3; ++col)
+            inverse->m[row][col] = real_div(cofactors[col][row], main_det);
+    }
+    for (int row = 0; row < 3; ++row)
+        inverse->m[row][3] = -real_add(real_add(real_mul(inverse->m[row][0], m[0][3]), real_mul(inverse->m[row][1], m[1][3])), real_mul(inverse->m[row][2], m[2][3]));
+    return 1;
+}
+
+world_point transform_point(const world_transform* const transform, const world_point p)
+{
+    world_point res = transform_vector(transform, p);
+    res.coords[0] = real_add(res.coords[0], transform->m[0][3]);
+    res.coords[1] = real_add(res.coords[1], transform->m[1][3]);
+    res.coords[2] = real_add(res.coords[2], transform->m[2][3]);
+    return res;
+}
+
+world_vector transform_vector(const world_transform* const transform, const world_vector v)
+{
+    world_vector res;
+    for (int row = 0; row < 3; ++row)
+        res.coords[row] = real_add(real_add(real_mul(transform->m[row][0], v.coords[0]), real_mul(transform->m[row][1], v.coords[1])), real_mul(transform->m[row][2], v.coords[2]));
+    return res;
+}
+
+world_vector transform_normal(const world_transform* const inverse, const world_vector n)
+{
+    world_vector res;
+    for (int col = 0; col < 3; ++col)
+        res.coords[col] = real_add(real_add(real_mul(inverse->m[0][col], n.coords[0]), real_mul(inverse->m[1][col], n.coords[1])), real_mul(inverse->m[2][col], n.coords[2]));
+    return res;
+}
+
+world_box transform_box(const world_transform* const transform, const world_box box)
+{
+    world_box res = empty_box();
+    for (int corner = 0; corner < 8; ++corner)
+    {
+        world_point p;
+        p.coords[0] = (corner & 1) ? box.max.coords[0] : box.min.coords[0];
+        p.coords[1] = (corner & 2) ? box.max.coords[1] : box.min.coords[1];
+        p.coords[2] = (corner & 4) ? box.max.coords[2] : box.min.coords[2];
+        world_box corner_box;
+        corner_box.min = transform_point(transform, p);
+        corner_box.max = corner_box.min;
+        res = merge_boxes(res, corner_box);
+    }
     return res;
 }
 
-static int find_nearest_object_intersection(const world_line line, scene_t* scene, float tmin, float tmax, float* t);
+typedef struct
+{
+    int object_index;
+    int instance_index;
+    real_t t;
+} ray_hit;
+
+static int find_nearest_object_intersection(const world_line line, scene_t* scene, real_t tmin, real_t tmax, ray_hit* hit);
 
 
 typedef struct
 {
-    float intensity;
+    real_t intensity;
 } ambient_light_object;
 
 typedef struct
 {
     world_point location;
-    float intensity;
+    real_t intensity;
 } point_light_object;
 
 typedef struct
 {
     world_point direction;
-    float intensity;
+    real_t intensity;
 } directed_light_object;
 
 static void destroy_light_object(void* light_object)
@@ -217,53 +447,53 @@ static void destroy_light_object(void* light_object)
     free(light_object);
 }
 
-static float compute_diffuse_light(const world_point light_direction, const material_t material, const float intensity)
+static real_t compute_diffuse_light(const world_point light_direction, const material_t material, const real_t intensity)
 {
-    const float cos_a = scalar_product(material.normal, light_direction) / length(material.normal) / length(light_direction);
-    if (cos_a <= 0.0f)
-        return 0.0f;
-    return cos_a * intensity;
+    const real_t cos_a = real_div(real_div(scalar_product(material.normal, light_direction), length(material.normal)), length(light_direction));
+    if (cos_a <= 0)
+        return 0;
+    return real_mul(cos_a, intensity);
 }
 
-static float compute_specular_light(const world_point light_direction, const material_t material, const float intensity, const world_point view_vector)
+static real_t compute_specular_light(const world_point light_direction, const material_t material, const real_t intensity, const world_point view_vector)
 {
     if (material.specularity == -1)
-        return 0.0f;
+        return 0;
     const world_point reflected_light_dir = reflect(light_direction, material.normal);
-    const float cos_a = scalar_product(reflected_light_dir, mul_by_factor(view_vector, -1.0f)) / length(reflected_light_dir) / length(view_vector);
-    if (cos_a <= 0.0f)
-        return 0.0f;
-    return (float)pow(cos_a, (float)material.specularity) * intensity;
+    const real_t cos_a = real_div(real_div(scalar_product(reflected_light_dir, mul_by_factor(view_vector, -REAL_ONE)), length(reflected_light_dir)), length(view_vector));
+    if (cos_a <= 0)
+        return 0;
+    return real_mul(real_pow_int(cos_a, material.specularity), intensity);
 }
 
-static float ambient_light_intensity(void* instance, scene_t* scene, const world_point point, const material_t material, const world_point view_vector)
+static real_t ambient_light_intensity(void* instance, scene_t* scene, const world_point point, const material_t material, const world_point view_vector)
 {
     return ((ambient_light_object*)instance)->intensity;
 }
 
-static float point_light_intensity(void* instance, scene_t* scene, const world_point point, const material_t material, const world_point view_vector)
+static real_t point_light_intensity(void* instance, scene_t* scene, const world_point point, const material_t material, const world_point view_vector)
 {
     const point_light_object* const point_light = (point_light_object*)instance;
     const world_point light_dir = sub(point_light->location, point);
-    const float intensity = point_light->intensity;
-    float t = 0;
-    if (find_nearest_object_intersection(create_line(point, light_dir), scene, T_EPS, FLT_MAX, &t) != -1)
-        return 0.0f;
+    const real_t intensity = point_light->intensity;
+    ray_hit hit;
+    if (find_nearest_object_intersection(create_line(point, light_dir), scene, T_EPS, REAL_MAX, &hit))
+        return 0;
     return compute_diffuse_light(light_dir, material, intensity) + compute_specular_light(light_dir, material, intensity, view_vector);
 }
 
-static float directed_light_intensity(void* instance, scene_t* scene, const world_point point, const material_t material, const world_point view_vector)
+static real_t directed_light_intensity(void* instance, scene_t* scene, const world_point point, const material_t material, const world_point view_vector)
 {
     const directed_light_object* const directed_light = (directed_light_object*)instance;
-    const world_point light_dir = mul_by_factor(directed_light->direction, -1);
-    const float intensity = directed_light->intensity;
-    float t = 0;
-    if (find_nearest_object_intersection(create_line(point, light_dir), scene, T_EPS, FLT_MAX, &t) != -1)
-        return 0.0f;
+    const world_point light_dir = mul_by_factor(directed_light->direction, -REAL_ONE);
+    const real_t intensity = directed_light->intensity;
+    ray_hit hit;
+    if (find_nearest_object_intersection(create_line(point, light_dir), scene, T_EPS, REAL_MAX, &hit))
+        return 0;
     return compute_diffuse_light(light_dir, material, intensity) + compute_specular_light(light_dir, material, intensity, view_vector);
 }
 
-light_object create_ambient_light(float intensity_value)
+light_object create_ambient_light(real_t intensity_value)
 {
     light_object light;
     ambient_light_object* ambient_light = malloc(sizeof(ambient_light_object));
@@ -274,7 +504,7 @@ light_object create_ambient_light(float intensity_value)
     return light;
 }
 
-light_object create_point_light(const world_point location, float intensity)
+light_object create_point_light(const world_point location, real_t intensity)
 {
     light_object light;
     point_light_object* point_light = malloc(sizeof(point_light_object));
@@ -286,7 +516,7 @@ light_object create_point_light(const world_point location, float intensity)
     return light;
 }
 
-light_object create_directed_light(const world_point direction, float intensity)
+light_object create_directed_light(const world_point direction, real_t intensity)
 {
     light_object light;
     directed_light_object* directed_light = malloc(sizeof(directed_light_object));
@@ -298,43 +528,44 @@ light_object create_directed_light(const world_point direction, float intensity)
     return light;
 }
 
-static float compute_light_intensity(scene_t* scene, const world_point point, const material_t material, const world_point view_vector)
+static real_t compute_light_intensity(scene_t* scene, const world_point point, const material_t material, const world_point view_vector)
 {
     if (scene->lights_count == 0)
-        return 1.0f;
-    float intensity = 0.0f;
+        return REAL_ONE;
+    real_t intensity = 0;
     for (int i = 0; i < scene->lights_count; ++i)
     {
         intensity += scene->light_objects[i].intensity_func(scene->light_objects[i].instance, scene, point, material, view_vector);
     }
-    return RAY_TRACER_MIN(intensity, 1.0f);
+    return RAY_TRACER_MIN(intensity, REAL_ONE);
 }
 
 
 static world_point viewport_point(screen_point p, const int canvas_width, const int canvas_height)
 {
     world_point res;
-    res.coords[0] = (p.coords[0] - canvas_width / 2.0f);
-    res.coords[1] = (canvas_height / 2.0f - p.coords[1]);
-    res.coords[2] = 1.0f;
+    res.coords[0] = (real_from_int(p.coords[0]) - real_div(real_from_int(canvas_width), REAL(2)));
+    res.coords[1] = (real_div(real_from_int(canvas_height), REAL(2)) - real_from_int(p.coords[1]));
+    res.coords[2] = REAL_ONE;
     return res;
 }
 
 static world_point from_viewport(world_point p, const int canvas_width, const int canvas_height)
 {
     world_point res;
-    res.coords[0] = p.coords[0] * view_port_w / canvas_width;
-    res.coords[1] = p.coords[1] * view_port_h / canvas_height;
-    res.coords[2] = 1.0f;
+    res.coords[0] = real_div(real_mul(p.coords[0], view_port_w), real_from_int(canvas_width));
+    res.coords[1] = real_div(real_mul(p.coords[1], view_port_h), real_from_int(canvas_height));
+    res.coords[2] = REAL_ONE;
     return res;
 }
 
-static int find_nearest_object_intersection(const world_line line, scene_t* scene, float tmin, float tmax, float* t)
+static int find_nearest_object_intersection(const world_line line, scene_t* scene, real_t tmin, real_t tmax, ray_hit* hit)
 {
-    int object_index = -1;
+    hit->object_index = -1;
+    hit->instance_index = -1;
     for (int i = 0; i < scene->objects_count; ++i)
     {
-        float roots[2];
+        real_t roots[2];
         const int roots_count = (int)scene->graphical_objects[i].intersect_func(scene->graphical_objects[i].instance, &line, roots);
         if (roots_count == 0)
             continue;
@@ -342,42 +573,117 @@ static int find_nearest_object_intersection(const world_line line, scene_t* scen
         {
             if (roots[root_index] < tmin || tmax < roots[root_index])
                 continue;
-            if (object_index == -1 || roots[root_index] < *t)
+            if (hit->object_index == -1 || roots[root_index] < hit->t)
             {
-                object_index = i;
-                *t = roots[root_index];
+                hit->object_index = i;
+                hit->t = roots[root_index];
             }
         }
     }
-    return object_index;
+    if (hit->object_index != -1)
+        tmax = hit->t;
+    int instance_index = -1;
+    int part_index = -1;
+    real_t t = 0;
+    if (intersect_line_with_instances(scene, &line, tmin, tmax, &instance_index, &part_index, &t))
+    {
+        hit->object_index = part_index;
+        hit->instance_index = instance_index;
+        hit->t = t;
+    }
+    return hit->object_index != -1;
+}
+
+//  Grazing rays are limited to a footprint 64 times the cone width
+#define FOOTPRINT_MIN_COS REAL(0.015625)
+
+real_t surface_footprint(const graphic_object* const object, const world_point point, const world_vector dir, const real_t footprint)
+{
+    if (!object->normal_func)
+        return footprint;
+    const world_vector normal = object->normal_func(object->instance, point);
+    const real_t cos_a = real_div(real_abs(scalar_product(normal, dir)), real_mul(length(normal), length(dir)));
+    return real_div(footprint, RAY_TRACER_MAX(cos_a, FOOTPRINT_MIN_COS));
+}
+
+static material_t hit_material(scene_t* scene, const world_line* const ray, const ray_hit* const hit, const world_point surface_point, const real_t footprint)
+{
+    if (hit->instance_index != -1)
+        return instance_material(&scene->instances[hit->instance_index], hit->object_index, ray, hit->t, footprint);
+    const graphic_object* const object = &scene->graphical_objects[hit->object_index];
+    return object->material_func(object->instance, surface_point, surface_footprint(object, surface_point, ray->dir, footprint));
+}
+
+static int same_line(const world_line* const l1, const world_line* const l2)
+{
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        if (l1->origin.coords[axis] != l2->origin.coords[axis] || l1->dir.coords[axis] != l2->dir.coords[axis])
+            return 0;
+    }
+    return 1;
+}
+
+//  Reuses the hit of the cached path when the ray is unchanged, otherwise traces it and drops the rest of the path
+static int find_path_hit(scene_t* scene, const world_line ray, const real_t tmin, const real_t tmax, cached_path* path, const int segment, int* const traced_count, ray_hit* hit, world_point* surface_point)
+{
+    if (path && segment < path->hits_count && same_line(&path->hits[segment].ray, &ray))
+    {
+        const cached_hit* const cached = &path->hits[segment];
+        hit->object_index = cached->object_index;
+        hit->instance_index = cached->instance_index;
+        hit->t = cached->t;
+        *surface_point = cached->position;
+        return hit->object_index != -1;
+    }
+    const int found = find_nearest_object_intersection(ray, scene, tmin, tmax, hit);
+    if (found)
+        *surface_point = line_point(ray, hit->t);
+    if (path && segment <= RAY_TRACER_REFLECTION_DEPTH)
+    {
+        ++*traced_count;
+        cached_hit* const cached = &path->hits[segment];
+        cached->ray = ray;
+        cached->object_index = hit->object_index;
+        cached->instance_index = hit->instance_index;
+        cached->t = found ? hit->t : REAL_MAX;
+        if (found)
+            cached->position = *surface_point;
+        else
+            zero(&cached->position);
+        path->hits_count = segment + 1;
+    }
+    return found;
 }
 
-static color_t trace_ray(scene_t* scene, const world_line ray, const float tmin, const float tmax, const int recursion_depth)
+//  Rays are traced as thin cones: cone_width at the origin, growing by cone_spread per unit of length.
+//  With a path, the ray is the given segment of it.
+static color_t trace_ray(scene_t* scene, const world_line ray, const real_t tmin, const real_t tmax, const int recursion_depth, const real_t cone_width, const real_t cone_spread,
+    cached_path* path, const int segment, int* const traced_count)
 {
-    float t = 0;
-    int object_index = find_nearest_object_intersection(ray, scene, tmin, tmax, &t);
-    if (object_index == -1)
+    ray_hit hit;
+    world_point surface_point;
+    if (!find_path_hit(scene, ray, tmin, tmax, path, segment, traced_count, &hit, &surface_point))
     {
         color_t c = {{ 0, 0, 0 }};
         return c;
     }
-    const world_point surface_point = line_point(ray, t);
-    const material_t material = scene->graphical_objects[object_index].material_func(scene->graphical_objects[object_index].instance, surface_point);
-    const float light_intensity = compute_light_intensity(scene, surface_point, material, ray.dir);
+    const real_t footprint = cone_width + real_mul(real_mul(hit.t, length(ray.dir)), cone_spread);
+    const material_t material = hit_material(scene, &ray, &hit, surface_point, footprint);
+    const real_t light_intensity = compute_light_intensity(scene, surface_point, material, ray.dir);
     const color_t color = mul_color_by_factor(material.color, light_intensity);
-    if (recursion_depth <= 0 || material.reflectivity <= 0 || material.reflectivity > 1)
+    if (recursion_depth <= 0 || material.reflectivity <= 0 || material.reflectivity > REAL_ONE)
         return color;
-    const color_t reflected_color = trace_ray(scene, create_line(surface_point, reflect(mul_by_factor(ray.dir, -1.0f), material.normal)), 
-        T_EPS, FLT_MAX, recursion_depth - 1);
+    const color_t reflected_color = trace_ray(scene, create_line(surface_point, reflect(mul_by_factor(ray.dir, -REAL_ONE), material.normal)), 
+        T_EPS, REAL_MAX, recursion_depth - 1, footprint, cone_spread, path, segment + 1, traced_count);
     return lerp_color(color, reflected_color, material.reflectivity);
 }
 
-void trace(const int canvas_width, const int canvas_height, put_pixel_callback put_pixel)
+//  Returns the number of cached pixels whose rays had to be intersected with the scene again
+static int render(scene_t* scene, const int canvas_width, const int canvas_height, render_cache* cache, put_pixel_callback put_pixel)
 {
-    if (!put_pixel)
-        return;
-    scene_t scene;
-    init_scene(&scene);
+    int res = 0;
+    const real_t pixel_spread = real_div(view_port_w, real_from_int(canvas_width));
     for (int row = 0; row < canvas_height; ++row)
     {
         for (int col = 0; col < canvas_width; ++col)
@@ -389,9 +695,37 @@ void trace(const int canvas_width, const int canvas_height, put_pixel_callback p
             world_line line;
             zero(&line.origin);
             line.dir = p;
-            const color_t c = trace_ray(&scene, line, 1.0f, FLT_MAX, 2);
+            cached_path* path = cache ? &cache->paths[row * canvas_width + col] : 0;
+            int traced_count = 0;
+            const color_t c = trace_ray(scene, line, REAL_ONE, REAL_MAX, RAY_TRACER_REFLECTION_DEPTH, 0, pixel_spread, path, 0, &traced_count);
+            if (traced_count > 0)
+                ++res;
             put_pixel(pixel_loc, c);
         }
     }
+    return res;
+}
+
+void trace_scene(scene_t* scene, const int canvas_width, const int canvas_height, put_pixel_callback put_pixel)
+{
+    if (!scene || !put_pixel)
+        return;
+    render(scene, canvas_width, canvas_height, 0, put_pixel);
+}
+
+int trace_scene_cached(scene_t* scene, render_cache* cache, put_pixel_callback put_pixel)
+{
+    if (!scene || !cache || !cache->paths || !put_pixel)
+        return 0;
+    return render(scene, cache->width, cache->height, cache, put_pixel);
+}
+
+void trace(const int canvas_width, const int canvas_height, put_pixel_callback put_pixel)
+{
+    if (!put_pixel)
+        return;
+    scene_t scene;
+    init_scene(&scene);
+    trace_scene(&scene, canvas_width, canvas_height, put_pixel);
     destroy_scene(&scene);
-}
\ No newline at end of file
+}
@@ -0,0 +1,60 @@
+#include "ray_tracer.h"
+
+int create_render_cache(render_cache* cache, const int canvas_width, const int canvas_height)
+{
+    cache->paths = 0;
+    cache->width = 0;
+    cache->height = 0;
+    if (canvas_width <= 0 || canvas_height <= 0)
+        return 0;
+    //  Zeroed paths have no hits, so the first render traces every pixel
+    cache->paths = calloc((size_t)canvas_width * canvas_height, sizeof(cached_path));
+    if (!cache->paths)
+        return 0;
+    cache->width = canvas_width;
+    cache->height = canvas_height;
+    return 1;
+}
+
+void destroy_render_cache(render_cache* cache)
+{
+    free(cache->paths);
+    cache->paths = 0;
+    cache->width = 0;
+    cache->height = 0;
+}
+
+void clear_render_cache(render_cache* cache)
+{
+    for (int i = 0; i < cache->width * cache->height; ++i)
+        cache->paths[i].hits_count = 0;
+}
+
+static int path_crosses_box(const cached_path* const path, const world_box* const bounds)
+{
+    for (int i = 0; i < path->hits_count; ++i)
+    {
+        const cached_hit* const hit = &path->hits[i];
+        //  The segment is stretched a little past the hit, whose point lies on the bounds of the hit object
+        real_t end = REAL_MAX;
+        if (hit->object_index != -1 && hit->t < REAL_MAX / 2)
+            end = hit->t + real_mul(hit->t, REAL(0.001)) + REAL(0.001);
+        if (intersect_line_with_box(&hit->ray, bounds, 0, end))
+            return 1;
+    }
+    return 0;
+}
+
+int invalidate_render_cache(render_cache* cache, const world_box* const bounds)
+{
+    int res = 0;
+    for (int i = 0; i < cache->width * cache->height; ++i)
+    {
+        if (path_crosses_box(&cache->paths[i], bounds))
+        {
+            cache->paths[i].hits_count = 0;
+            ++res;
+        }
+    }
+    return res;
+}
@@ -0,0 +1,328 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+#include "ray_tracer.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define TEXTURE_TILE_TEXELS (TEXTURE_TILE_SIZE * TEXTURE_TILE_SIZE)
+//  Texel coordinates are Q16.16 numbers in fixed point builds
+#ifdef RAY_TRACER_FIXED_POINT
+#define TEXTURE_MAX_SIDE 32767
+#else
+#define TEXTURE_MAX_SIDE INT_MAX
+#endif
+
+//  Preprocessed texture file: this header followed by the tiled texels of all levels
+typedef struct
+{
+    char magic[4];
+    int levels_count;
+    int sizes[TEXTURE_MAX_LEVELS][2];
+} texture_file_header;
+
+static const char texture_magic[4] = { 'R', 'T', 'T', 'X' };
+
+static void reset_texture(texture_t* texture)
+{
+    texture->texels = 0;
+    texture->texels_count = 0;
+    texture->levels_count = 0;
+    texture->mapping = 0;
+}
+
+static size_t layout_levels(texture_t* texture, int width, int height)
+{
+    size_t offset = 0;
+    texture->levels_count = 0;
+    while (texture->levels_count < TEXTURE_MAX_LEVELS)
+    {
+        texture_level* const level = &texture->levels[texture->levels_count++];
+        const int tiles_per_column = (height + TEXTURE_TILE_SIZE - 1) / TEXTURE_TILE_SIZE;
+        level->width = width;
+        level->height = height;
+        level->tiles_per_row = (width + TEXTURE_TILE_SIZE - 1) / TEXTURE_TILE_SIZE;
+        level->offset = offset;
+        offset += (size_t)level->tiles_per_row * tiles_per_column * TEXTURE_TILE_TEXELS;
+        if (width == 1 && height == 1)
+            break;
+        width = RAY_TRACER_MAX(1, width / 2);
+        height = RAY_TRACER_MAX(1, height / 2);
+    }
+    return offset;
+}
+
+static color_t* texel_at(const texture_t* const texture, const texture_level* const level, const int x, const int y)
+{
+    const size_t tile = (size_t)(y / TEXTURE_TILE_SIZE) * level->tiles_per_row + x / TEXTURE_TILE_SIZE;
+    return &texture->texels[level->offset + tile * TEXTURE_TILE_TEXELS + (y % TEXTURE_TILE_SIZE) * TEXTURE_TILE_SIZE + x % TEXTURE_TILE_SIZE];
+}
+
+int create_texture(texture_t* texture, const color_t* pixels, const int width, const int height)
+{
+    reset_texture(texture);
+    if (!pixels || width <= 0 || height <= 0 || width > TEXTURE_MAX_SIDE || height > TEXTURE_MAX_SIDE)
+        return 0;
+    texture->texels_count = layout_levels(texture, width, height);
+    texture->texels = calloc(texture->texels_count, sizeof(color_t));
+    if (!texture->texels)
+    {
+        reset_texture(texture);
+        return 0;
+    }
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+            *texel_at(texture, &texture->levels[0], x, y) = pixels[(size_t)y * width + x];
+    }
+    for (int i = 1; i < texture->levels_count; ++i)
+    {
+        const texture_level* const source = &texture->levels[i - 1];
+        const texture_level* const level = &texture->levels[i];
+        for (int y = 0; y < level->height; ++y)
+        {
+            const int y0 = RAY_TRACER_MIN(2 * y, source->height - 1);
+            const int y1 = RAY_TRACER_MIN(2 * y + 1, source->height - 1);
+            for (int x = 0; x < level->width; ++x)
+            {
+                const int x0 = RAY_TRACER_MIN(2 * x, source->width - 1);
+                const int x1 = RAY_TRACER_MIN(2 * x + 1, source->width - 1);
+                const color_t* const c00 = texel_at(texture, source, x0, y0);
+                const color_t* const c10 = texel_at(texture, source, x1, y0);
+                const color_t* const c01 = texel_at(texture, source, x0, y1);
+                const color_t* const c11 = texel_at(texture, source, x1, y1);
+                color_t* const res = texel_at(texture, level, x, y);
+                for (int channel = 0; channel < 3; ++channel)
+                    res->channels[channel] = (unsigned char)((c00->channels[channel] + c10->channels[channel] + c01->channels[channel] + c11->channels[channel] + 2) / 4);
+            }
+        }
+    }
+    return 1;
+}
+
+static int read_ppm_number(FILE* file, int* value)
+{
+    int c = fgetc(file);
+    while (c == '#' || isspace(c))
+    {
+        if (c == '#')
+        {
+            while (c != '\n' && c != EOF)
+                c = fgetc(file);
+        }
+        c = fgetc(file);
+    }
+    ungetc(c, file);
+    return fscanf(file, "%d", value) == 1;
+}
+
+int load_ppm_texture(texture_t* texture, const char* path)
+{
+    reset_texture(texture);
+    FILE* file = fopen(path, "rb");
+    if (!file)
+        return 0;
+    char magic[2];
+    int width = 0;
+    int height = 0;
+    int max_value = 0;
+    if (fread(magic, 1, 2, file) != 2 || magic[0] != 'P' || (magic[1] != '3' && magic[1] != '6')
+        || !read_ppm_number(file, &width) || !read_ppm_number(file, &height) || !read_ppm_number(file, &max_value)
+        || width <= 0 || height <= 0 || max_value <= 0 || max_value > 255)
+    {
+        fclose(file);
+        return 0;
+    }
+    const size_t values_count = (size_t)width * height * 3;
+    unsigned char* values = malloc(values_count);
+    int loaded = values != 0;
+    if (loaded && magic[1] == '6')
+    {
+        fgetc(file);
+        loaded = fread(values, 1, values_count, file) == values_count;
+    }
+    for (size_t i = 0; loaded && magic[1] == '3' && i < values_count; ++i)
+    {
+        int value = 0;
+        loaded = read_ppm_number(file, &value);
+        values[i] = (unsigned char)value;
+    }
+    fclose(file);
+    if (loaded && max_value != 255)
+    {
+        for (size_t i = 0; i < values_count; ++i)
+            values[i] = (unsigned char)(RAY_TRACER_MIN(values[i], max_value) * 255 / max_value);
+    }
+    if (loaded)
+        loaded = create_texture(texture, (const color_t*)values, width, height);
+    free(values);
+    return loaded;
+}
+
+int load_raw_texture(texture_t* texture, const char* path, const int width, const int height)
+{
+    reset_texture(texture);
+    if (width <= 0 || height <= 0)
+        return 0;
+    FILE* file = fopen(path, "rb");
+    if (!file)
+        return 0;
+    const size_t pixels_count = (size_t)width * height;
+    color_t* pixels = malloc(sizeof(color_t) * pixels_count);
+    int loaded = pixels && fread(pixels, sizeof(color_t), pixels_count, file) == pixels_count;
+    fclose(file);
+    if (loaded)
+        loaded = create_texture(texture, pixels, width, height);
+    free(pixels);
+    return loaded;
+}
+
+int save_texture(const texture_t* const texture, const char* path)
+{
+    if (!texture->texels)
+        return 0;
+    texture_file_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, texture_magic, sizeof(texture_magic));
+    header.levels_count = texture->levels_count;
+    for (int i = 0; i < texture->levels_count; ++i)
+    {
+        header.sizes[i][0] = texture->levels[i].width;
+        header.sizes[i][1] = texture->levels[i].height;
+    }
+    FILE* file = fopen(path, "wb");
+    if (!file)
+        return 0;
+    const int saved = fwrite(&header, sizeof(header), 1, file) == 1
+        && fwrite(texture->texels, sizeof(color_t), texture->texels_count, file) == texture->texels_count;
+    return fclose(file) == 0 && saved;
+}
+
+static void* map_file(const char* path, size_t* size)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    if (file == INVALID_HANDLE_VALUE)
+        return 0;
+    LARGE_INTEGER file_size;
+    void* data = 0;
+    if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0)
+    {
+        HANDLE mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+        if (mapping)
+        {
+            data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+        }
+        *size = (size_t)file_size.QuadPart;
+    }
+    CloseHandle(file);
+    return data;
+#else
+    const int file = open(path, O_RDONLY);
+    if (file < 0)
+        return 0;
+    struct stat file_stat;
+    void* data = 0;
+    if (fstat(file, &file_stat) == 0 && file_stat.st_size > 0)
+    {
+        data = mmap(0, (size_t)file_stat.st_size, PROT_READ, MAP_SHARED, file, 0);
+        if (data == MAP_FAILED)
+            data = 0;
+        *size = (size_t)file_stat.st_size;
+    }
+    close(file);
+    return data;
+#endif
+}
+
+static void unmap_file(void* data, const size_t size)
+{
+#ifdef _WIN32
+    (void)size;
+    UnmapViewOfFile(data);
+#else
+    munmap(data, size);
+#endif
+}
+
+int map_texture(texture_t* texture, const char* path)
+{
+    reset_texture(texture);
+    size_t size = 0;
+    void* data = map_file(path, &size);
+    if (!data)
+        return 0;
+    const texture_file_header* const header = (const texture_file_header*)data;
+    int valid = size >= sizeof(texture_file_header) && memcmp(header->magic, texture_magic, sizeof(texture_magic)) == 0
+        && header->levels_count > 0 && header->levels_count <= TEXTURE_MAX_LEVELS
+        && header->sizes[0][0] > 0 && header->sizes[0][1] > 0
+        && header->sizes[0][0] <= TEXTURE_MAX_SIDE && header->sizes[0][1] <= TEXTURE_MAX_SIDE;
+    if (valid)
+    {
+        texture->texels_count = layout_levels(texture, header->sizes[0][0], header->sizes[0][1]);
+        valid = texture->levels_count == header->levels_count && size == sizeof(texture_file_header) + sizeof(color_t) * texture->texels_count;
+    }
+    if (!valid)
+    {
+        unmap_file(data, size);
+        reset_texture(texture);
+        return 0;
+    }
+    //  Mapped texels are read only
+    texture->texels = (color_t*)((char*)data + sizeof(texture_file_header));
+    texture->mapping = data;
+    return 1;
+}
+
+void destroy_texture(texture_t* texture)
+{
+    if (texture->mapping)
+        unmap_file(texture->mapping, sizeof(texture_file_header) + sizeof(color_t) * texture->texels_count);
+    else
+        free(texture->texels);
+    reset_texture(texture);
+}
+
+color_t sample_texture(const texture_t* const texture, real_t u, real_t v, const real_t footprint)
+{
+    if (!texture || texture->levels_count == 0)
+    {
+        color_t c = {{ 0, 0, 0 }};
+        return c;
+    }
+    //  The level is chosen so that the footprint covers about one texel
+    const int size = RAY_TRACER_MAX(texture->levels[0].width, texture->levels[0].height);
+    int footprint_texels = real_to_int(real_mul(footprint, real_from_int(size)));
+    int level_index = 0;
+    while (footprint_texels > 1 && level_index + 1 < texture->levels_count)
+    {
+        footprint_texels >>= 1;
+        ++level_index;
+    }
+    const texture_level* const level = &texture->levels[level_index];
+    u = real_mul(u - real_floor(u), real_from_int(level->width)) - REAL(0.5);
+    v = real_mul(v - real_floor(v), real_from_int(level->height)) - REAL(0.5);
+    const real_t x_floor = real_floor(u);
+    const real_t y_floor = real_floor(v);
+    int x0 = real_to_int(x_floor);
+    int y0 = real_to_int(y_floor);
+    if (x0 < 0)
+        x0 += level->width;
+    if (y0 < 0)
+        y0 += level->height;
+    const int x1 = x0 + 1 < level->width ? x0 + 1 : 0;
+    const int y1 = y0 + 1 < level->height ? y0 + 1 : 0;
+    const color_t top = lerp_color(*texel_at(texture, level, x0, y0), *texel_at(texture, level, x1, y0), u - x_floor);
+    const color_t bottom = lerp_color(*texel_at(texture, level, x0, y1), *texel_at(texture, level, x1, y1), u - x_floor);
+    return lerp_color(top, bottom, v - y_floor);
+}
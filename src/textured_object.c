@@ -0,0 +1,182 @@
+#include "ray_tracer.h"
+
+typedef struct
+{
+	world_sphere sphere;
+	const texture_t* texture;
+	int specularity;
+	real_t reflectivity;
+} textured_sphere_t;
+
+typedef struct
+{
+	world_plane plane;
+	world_vector tangent;
+	world_vector bitangent;
+	real_t tile_size;
+	const texture_t* texture;
+	int specularity;
+	real_t reflectivity;
+} textured_plane_t;
+
+typedef struct
+{
+	world_point* vertices;
+	int count;
+	world_box bounds;
+	const texture_t* texture;
+	int specularity;
+	real_t reflectivity;
+} textured_poly_t;
+
+static void destroy_textured_object(void* textured_object)
+{
+	free(textured_object);
+}
+
+static intersection_result intersect_textured_sphere(void* instance, const world_line* const line, real_t* const roots)
+{
+	textured_sphere_t* sphere_object = (textured_sphere_t*)(instance);
+	return intersect_line_with_sphere(line, &sphere_object->sphere, roots);
+}
+
+static world_vector textured_sphere_normal(void* instance, const world_point point)
+{
+	textured_sphere_t* sphere_object = (textured_sphere_t*)(instance);
+	return normalize(sub(point, sphere_object->sphere.center));
+}
+
+static material_t textured_sphere_material_getter(void* instance, const world_point point, const real_t footprint)
+{
+	textured_sphere_t* sphere_object = (textured_sphere_t*)(instance);
+	material_t material;
+	material.normal = textured_sphere_normal(instance, point);
+	//	Cylindrical equal-area mapping, texture height spans the sphere diameter
+	const real_t u = real_div(real_atan2(material.normal.coords[2], material.normal.coords[0]), REAL(6.28318531)) + REAL(0.5);
+	const real_t v = real_div(REAL_ONE - material.normal.coords[1], REAL(2));
+	const real_t uv_footprint = real_div(footprint, real_mul(REAL(2), sphere_object->sphere.radius));
+	material.color = sample_texture(sphere_object->texture, u, v, uv_footprint);
+	material.specularity = sphere_object->specularity;
+	material.reflectivity = sphere_object->reflectivity;
+	return material;
+}
+
+graphic_object create_textured_sphere(const world_sphere sphere, const texture_t* const texture, const int specularity, const real_t reflectivity)
+{
+	graphic_object res;
+	textured_sphere_t* sphere_object = malloc(sizeof(textured_sphere_t));
+	sphere_object->sphere = sphere;
+	sphere_object->texture = texture;
+	sphere_object->specularity = specularity;
+	sphere_object->reflectivity = reflectivity;
+	res.instance = sphere_object;
+	res.intersect_func = intersect_textured_sphere;
+	res.material_func = textured_sphere_material_getter;
+	res.normal_func = textured_sphere_normal;
+	res.destroy_func = destroy_textured_object;
+	return res;
+}
+
+static intersection_result intersect_textured_plane(void* instance, const world_line* const line, real_t* const roots)
+{
+	textured_plane_t* plane_object = (textured_plane_t*)(instance);
+	return intersect_line_with_plane(line, &plane_object->plane, roots);
+}
+
+static world_vector textured_plane_normal(void* instance, const world_point point)
+{
+	return ((textured_plane_t*)(instance))->plane.normal;
+}
+
+static material_t textured_plane_material_getter(void* instance, const world_point point, const real_t footprint)
+{
+	textured_plane_t* plane_object = (textured_plane_t*)(instance);
+	material_t material;
+	const real_t u = real_div(scalar_product(point, plane_object->tangent), plane_object->tile_size);
+	const real_t v = real_div(scalar_product(point, plane_object->bitangent), plane_object->tile_size);
+	material.color = sample_texture(plane_object->texture, u, v, real_div(footprint, plane_object->tile_size));
+	material.normal = plane_object->plane.normal;
+	material.specularity = plane_object->specularity;
+	material.reflectivity = plane_object->reflectivity;
+	return material;
+}
+
+graphic_object create_textured_plane(const world_plane plane, const texture_t* const texture, const real_t tile_size, const int specularity, const real_t reflectivity)
+{
+	graphic_object res;
+	textured_plane_t* plane_object = malloc(sizeof(textured_plane_t));
+	world_vector axis;
+	zero(&axis);
+	axis.coords[real_abs(plane.normal.coords[0]) < REAL(0.9) ? 0 : 1] = REAL_ONE;
+	plane_object->plane = plane;
+	plane_object->tangent = normalize(cross_product(axis, plane.normal));
+	plane_object->bitangent = normalize(cross_product(plane.normal, plane_object->tangent));
+	plane_object->tile_size = tile_size;
+	plane_object->texture = texture;
+	plane_object->specularity = specularity;
+	plane_object->reflectivity = reflectivity;
+	res.instance = plane_object;
+	res.intersect_func = intersect_textured_plane;
+	res.material_func = textured_plane_material_getter;
+	res.normal_func = textured_plane_normal;
+	res.destroy_func = destroy_textured_object;
+	return res;
+}
+
+static intersection_result intersect_textured_poly(void* instance, const world_line* const line, real_t* const roots)
+{
+	textured_poly_t* poly = (textured_poly_t*)(instance);
+	return intersect_line_with_poly(line, poly->vertices, poly->count, roots);
+}
+
+//	Polygons lie in a constant z plane
+static world_vector textured_poly_normal(void* instance, const world_point point)
+{
+	world_vector normal;
+	zero(&normal);
+	normal.coords[2] = -REAL_ONE;
+	return normal;
+}
+
+static material_t textured_poly_material_getter(void* instance, const world_point point, const real_t footprint)
+{
+	textured_poly_t* poly = (textured_poly_t*)(instance);
+	material_t material;
+	//	The texture is stretched over the bounding rectangle of the polygon
+	const real_t width = poly->bounds.max.coords[0] - poly->bounds.min.coords[0];
+	const real_t height = poly->bounds.max.coords[1] - poly->bounds.min.coords[1];
+	const real_t u = real_div(point.coords[0] - poly->bounds.min.coords[0], width);
+	const real_t v = real_div(poly->bounds.max.coords[1] - point.coords[1], height);
+	material.color = sample_texture(poly->texture, u, v, real_div(footprint, RAY_TRACER_MAX(width, height)));
+	material.normal = textured_poly_normal(instance, point);
+	material.specularity = poly->specularity;
+	material.reflectivity = poly->reflectivity;
+	return material;
+}
+
+static void destroy_textured_poly(void* instance)
+{
+	textured_poly_t* poly = (textured_poly_t*)(instance);
+	free(poly->vertices);
+	free(poly);
+}
+
+graphic_object create_textured_poly(const world_point* vertices, const int count, const texture_t* const texture, const int specularity, const real_t reflectivity)
+{
+	graphic_object res;
+	textured_poly_t* poly = malloc(sizeof(textured_poly_t));
+	poly->vertices = malloc(sizeof(world_point) * count);
+	poly->count = count;
+	for (int i = 0; i < count; ++i)
+		poly->vertices[i] = vertices[i];
+	poly->bounds = poly_box(vertices, count);
+	poly->texture = texture;
+	poly->specularity = specularity;
+	poly->reflectivity = reflectivity;
+	res.instance = poly;
+	res.intersect_func = intersect_textured_poly;
+	res.material_func = textured_poly_material_getter;
+	res.normal_func = textured_poly_normal;
+	res.destroy_func = destroy_textured_poly;
+	return res;
+}
@@ -0,0 +1,574 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "ray_tracer.h"
+
+//  Renders the reference scenes and compares them with the golden images of the data directory,
+//  checks analytic results of the intersection routines and the render time budgets.
+//  Usage: regression_checker <data_dir> [--update]
+//  --update rewrites the golden images from the current build instead of comparing.
+
+#define IMAGE_WIDTH 128
+#define IMAGE_HEIGHT 128
+#define BENCHMARK_WIDTH 256
+#define BENCHMARK_HEIGHT 256
+#define BENCHMARK_RUNS 3
+#define MAX_PATH_LENGTH 1024
+
+//  Golden images are rendered by the float build, the fixed point one is held to the README tolerance
+#ifdef RAY_TRACER_FIXED_POINT
+#define PIXEL_TOLERANCE 8
+#define MISMATCHED_PIXELS_PERCENT 2.0
+#define ANALYTIC_TOLERANCE 0.01f
+#define BUDGETS_FILE "budgets_fixed.txt"
+#else
+#define PIXEL_TOLERANCE 2
+#define MISMATCHED_PIXELS_PERCENT 0.1
+#define ANALYTIC_TOLERANCE 0.0001f
+#define BUDGETS_FILE "budgets.txt"
+#endif
+
+static color_t image[BENCHMARK_HEIGHT][BENCHMARK_WIDTH];
+static int failures_count = 0;
+
+static void put_pixel_func(screen_point p, color_t pixel)
+{
+    image[p.coords[1]][p.coords[0]] = pixel;
+}
+
+static void report(const int passed, const char* check, const char* details)
+{
+    printf("[%s] %s%s%s\n", passed ? "PASS" : "FAIL", check, details[0] ? ": " : "", details);
+    if (!passed)
+        ++failures_count;
+}
+
+static world_point make_point(const real_t x, const real_t y, const real_t z)
+{
+    world_point p;
+    p.coords[0] = x;
+    p.coords[1] = y;
+    p.coords[2] = z;
+    return p;
+}
+
+static int close_to(const real_t value, const float expected)
+{
+    return fabsf(real_to_float(value) - expected) <= ANALYTIC_TOLERANCE * (1.0f + fabsf(expected));
+}
+
+static void check_analytic_results(void)
+{
+    char details[256];
+    real_t t[2] = { 0, 0 };
+    int roots_count = solve_quadratic(REAL_ONE, REAL(-3), REAL(2), t);
+    sprintf(details, "x^2 - 3x + 2 gives %d roots %f %f", roots_count, real_to_float(t[0]), real_to_float(t[1]));
+    report(roots_count == 2 && close_to(t[0], 1.0f) && close_to(t[1], 2.0f), "solve_quadratic two roots", details);
+    roots_count = solve_quadratic(REAL_ONE, REAL(-4), REAL(4), t);
+    sprintf(details, "x^2 - 4x + 4 gives %d roots %f", roots_count, real_to_float(t[0]));
+    report(roots_count == 1 && close_to(t[0], 2.0f), "solve_quadratic double root", details);
+    roots_count = solve_quadratic(REAL_ONE, 0, REAL_ONE, t);
+    sprintf(details, "x^2 + 1 gives %d roots", roots_count);
+    report(roots_count == 0, "solve_quadratic no roots", details);
+
+    world_sphere sphere;
+    sphere.center = make_point(0, 0, REAL(5));
+    sphere.radius = REAL_ONE;
+    world_line line = create_line(make_point(0, 0, 0), make_point(0, 0, REAL_ONE));
+    roots_count = (int)intersect_line_with_sphere(&line, &sphere, t);
+    sprintf(details, "%d roots %f %f, expected 4 and 6", roots_count, real_to_float(t[0]), real_to_float(t[1]));
+    report(roots_count == 2 && close_to(t[0], 4.0f) && close_to(t[1], 6.0f), "intersect_line_with_sphere through center", details);
+    line = create_line(make_point(REAL(2), 0, 0), make_point(0, 0, REAL_ONE));
+    roots_count = (int)intersect_line_with_sphere(&line, &sphere, t);
+    sprintf(details, "%d roots", roots_count);
+    report(roots_count == 0, "intersect_line_with_sphere miss", details);
+
+    world_point square[4];
+    square[0] = make_point(REAL(-1), REAL(-1), REAL(3));
+    square[1] = make_point(REAL(1), REAL(-1), REAL(3));
+    square[2] = make_point(REAL(1), REAL(1), REAL(3));
+    square[3] = make_point(REAL(-1), REAL(1), REAL(3));
+    line = create_line(make_point(REAL(0.25), REAL(0.5), 0), make_point(0, 0, REAL_ONE));
+    intersection_result result = intersect_line_with_poly(&line, square, 4, t);
+    sprintf(details, "result %d t %f, expected 3", (int)result, real_to_float(t[0]));
+    report(result == INTERSECTED && close_to(t[0], 3.0f), "intersect_line_with_poly inside", details);
+    line = create_line(make_point(REAL(1.5), REAL(0.5), 0), make_point(0, 0, REAL_ONE));
+    result = intersect_line_with_poly(&line, square, 4, t);
+    sprintf(details, "result %d", (int)result);
+    report(result == NOT_INTERSECTED, "intersect_line_with_poly outside", details);
+}
+
+//  Scene with everything the reference scenes need, torn down by destroy_test_scene()
+typedef struct
+{
+    scene_t scene;
+    light_object lights[3];
+    graphic_object objects[4];
+    graphic_instance instances[64];
+    graphic_prototype prototype;
+    int has_prototype;
+    texture_t textures[2];
+    int textures_count;
+} test_scene;
+
+static void init_test_scene(test_scene* test)
+{
+    memset(test, 0, sizeof(test_scene));
+    test->scene.light_objects = test->lights;
+    test->scene.graphical_objects = test->objects;
+    test->scene.instances = test->instances;
+    build_bvh(&test->scene.instances_tree, 0, 0);
+}
+
+static void destroy_test_scene(test_scene* test)
+{
+    for (int i = 0; i < test->scene.lights_count; ++i)
+        test->lights[i].destroy_func(test->lights[i].instance);
+    for (int i = 0; i < test->scene.objects_count; ++i)
+        test->objects[i].destroy_func(test->objects[i].instance);
+    if (test->has_prototype)
+        destroy_prototype(&test->prototype);
+    destroy_bvh(&test->scene.instances_tree);
+    for (int i = 0; i < test->textures_count; ++i)
+        destroy_texture(&test->textures[i]);
+}
+
+static void add_standard_lights(test_scene* test)
+{
+    test->lights[test->scene.lights_count++] = create_ambient_light(REAL(0.2));
+    test->lights[test->scene.lights_count++] = create_point_light(make_point(REAL(-2), REAL(3), REAL(4)), REAL(0.6));
+    test->lights[test->scene.lights_count++] = create_directed_light(make_point(REAL(1), REAL(-4), REAL(4)), REAL(0.2));
+}
+
+static texture_t* add_checker_texture(test_scene* test, const int size, const int cell, const color_t first, const color_t second)
+{
+    color_t* pixels = malloc(sizeof(color_t) * size * size);
+    for (int y = 0; y < size; ++y)
+    {
+        for (int x = 0; x < size; ++x)
+            pixels[y * size + x] = ((x / cell + y / cell) % 2) ? first : second;
+    }
+    texture_t* texture = &test->textures[test->textures_count++];
+    create_texture(texture, pixels, size, size);
+    free(pixels);
+    return texture;
+}
+
+static world_sphere textured_scene_ball(void)
+{
+    world_sphere ball;
+    ball.center = make_point(REAL(-0.6), REAL(0.1), REAL(5));
+    ball.radius = REAL(0.6);
+    return ball;
+}
+
+static void build_textured_scene(test_scene* test)
+{
+    const color_t dark = {{ 30, 40, 90 }};
+    const color_t light = {{ 230, 220, 160 }};
+    const color_t red = {{ 200, 40, 30 }};
+    const color_t white = {{ 250, 250, 250 }};
+    const texture_t* floor_texture = add_checker_texture(test, 64, 8, dark, light);
+    const texture_t* ball_texture = add_checker_texture(test, 32, 4, red, white);
+    add_standard_lights(test);
+    world_plane floor;
+    floor.normal = make_point(0, REAL_ONE, 0);
+    floor.D = REAL(0.5);
+    test->objects[test->scene.objects_count++] = create_textured_plane(floor, floor_texture, REAL(2), 300, REAL(0.3));
+    test->objects[test->scene.objects_count++] = create_textured_sphere(textured_scene_ball(), ball_texture, 100, REAL(0.2));
+    world_point board[4];
+    board[0] = make_point(REAL(0.3), REAL(-0.5), REAL(7));
+    board[1] = make_point(REAL(2.3), REAL(-0.5), REAL(7));
+    board[2] = make_point(REAL(2.3), REAL(1.5), REAL(7));
+    board[3] = make_point(REAL(0.3), REAL(1.5), REAL(7));
+    test->objects[test->scene.objects_count++] = create_textured_poly(board, 4, ball_texture, -1, 0);
+}
+
+static void build_instanced_scene(test_scene* test)
+{
+    const color_t green = {{ 40, 140, 50 }};
+    const color_t olive = {{ 90, 110, 30 }};
+    const color_t gray = {{ 110, 110, 110 }};
+    const color_t sand = {{ 170, 150, 110 }};
+    const texture_t* leaves_texture = add_checker_texture(test, 16, 2, green, olive);
+    const texture_t* ground_texture = add_checker_texture(test, 16, 8, gray, sand);
+    add_standard_lights(test);
+    world_plane ground;
+    ground.normal = make_point(0, REAL_ONE, 0);
+    ground.D = REAL(0.5);
+    test->objects[test->scene.objects_count++] = create_textured_plane(ground, ground_texture, REAL(4), -1, REAL(0.1));
+    //  Prototype "tree" made of three stacked spheres, resting on the origin
+    graphic_object parts[3];
+    world_box parts_bounds[3];
+    for (int i = 0; i < 3; ++i)
+    {
+        world_sphere crown;
+        crown.radius = REAL(0.3) - real_mul(real_from_int(i), REAL(0.08));
+        crown.center = make_point(0, REAL(0.3) + real_mul(real_from_int(i), REAL(0.35)), 0);
+        parts[i] = create_textured_sphere(crown, leaves_texture, 50, 0);
+        parts_bounds[i] = sphere_box(&crown);
+    }
+    init_prototype(&test->prototype, parts, parts_bounds, 3);
+    test->has_prototype = 1;
+    for (int row = 0; row < 8; ++row)
+    {
+        for (int col = 0; col < 8; ++col)
+        {
+            const int index = row * 8 + col;
+            const world_transform translation = translation_transform(make_point(real_from_int(col - 4), REAL(-0.5), real_from_int(3 + 2 * row)));
+            const world_transform rotation = rotation_transform(make_point(0, REAL_ONE, 0), real_mul(real_from_int(index), REAL(0.7)));
+            const real_t scale = REAL(0.7) + real_mul(real_from_int(index % 5), REAL(0.15));
+            const world_transform scaling = scale_transform(make_point(scale, scale, scale));
+            const world_transform placement = compose_transforms(&rotation, &scaling);
+            const world_transform to_world = compose_transforms(&translation, &placement);
+            test->instances[index] = create_instance(&test->prototype, &to_world);
+        }
+    }
+    test->scene.instances_count = 64;
+    build_instances_tree(&test->scene);
+}
+
+//  Cached render of the edited scene must match a full render exactly, and trace again only the expected pixels
+static void compare_incremental_render(test_scene* test, render_cache* cache, const char* edit, const int expected_traced_count)
+{
+    static color_t full_image[IMAGE_HEIGHT][IMAGE_WIDTH];
+    char check[128];
+    char details[160];
+    trace_scene(&test->scene, IMAGE_WIDTH, IMAGE_HEIGHT, put_pixel_func);
+    for (int row = 0; row < IMAGE_HEIGHT; ++row)
+        memcpy(full_image[row], image[row], sizeof(color_t) * IMAGE_WIDTH);
+    const int traced_count = trace_scene_cached(&test->scene, cache, put_pixel_func);
+    int mismatched = 0;
+    for (int row = 0; row < IMAGE_HEIGHT; ++row)
+        mismatched += memcmp(full_image[row], image[row], sizeof(color_t) * IMAGE_WIDTH) != 0;
+    sprintf(check, "incremental render after %s", edit);
+    sprintf(details, "%d of %d pixels traced again (expected %d), %d rows differ from a full render", traced_count, IMAGE_WIDTH * IMAGE_HEIGHT, expected_traced_count, mismatched);
+    report(mismatched == 0 && traced_count == expected_traced_count, check, details);
+}
+
+static void check_incremental_rendering(void)
+{
+    test_scene test;
+    render_cache cache;
+    init_test_scene(&test);
+    build_textured_scene(&test);
+    if (!create_render_cache(&cache, IMAGE_WIDTH, IMAGE_HEIGHT))
+    {
+        report(0, "render cache creation", "");
+        destroy_test_scene(&test);
+        return;
+    }
+    compare_incremental_render(&test, &cache, "first render", IMAGE_WIDTH * IMAGE_HEIGHT);
+    //  Same sphere with another texture and a mirror finish
+    graphic_object* ball = &test.objects[1];
+    ball->destroy_func(ball->instance);
+    *ball = create_textured_sphere(textured_scene_ball(), &test.textures[0], 10, REAL(0.6));
+    compare_incremental_render(&test, &cache, "material edit", 0);
+    light_object* light = &test.lights[1];
+    light->destroy_func(light->instance);
+    *light = create_point_light(make_point(REAL(2), REAL(2), REAL(3)), REAL(0.4));
+    compare_incremental_render(&test, &cache, "light edit", 0);
+    world_sphere moved_ball = textured_scene_ball();
+    const world_box old_bounds = sphere_box(&moved_ball);
+    moved_ball.center.coords[0] += REAL(0.4);
+    moved_ball.center.coords[1] += REAL(0.3);
+    const world_box new_bounds = sphere_box(&moved_ball);
+    ball->destroy_func(ball->instance);
+    *ball = create_textured_sphere(moved_ball, &test.textures[0], 10, REAL(0.6));
+    const int invalidated_count = invalidate_render_cache(&cache, &old_bounds) + invalidate_render_cache(&cache, &new_bounds);
+    compare_incremental_render(&test, &cache, "geometry edit", invalidated_count);
+    destroy_render_cache(&cache);
+    destroy_test_scene(&test);
+}
+
+#define TEXTURE_FILE_WIDTH 13
+#define TEXTURE_FILE_HEIGHT 7
+
+static int same_texture(const texture_t* const lhs, const texture_t* const rhs)
+{
+    if (lhs->levels_count != rhs->levels_count || lhs->texels_count != rhs->texels_count
+        || memcmp(lhs->levels, rhs->levels, sizeof(texture_level) * lhs->levels_count) != 0)
+        return 0;
+    return memcmp(lhs->texels, rhs->texels, sizeof(color_t) * lhs->texels_count) == 0;
+}
+
+static int write_file(const char* path, const void* data, const size_t size)
+{
+    FILE* fp = fopen(path, "wb");
+    if (!fp)
+        return 0;
+    const int written = fwrite(data, 1, size, fp) == size;
+    return fclose(fp) == 0 && written;
+}
+
+static void check_loaded_texture(const char* check, const int loaded, texture_t* texture, const texture_t* const reference)
+{
+    report(loaded && same_texture(texture, reference), check, loaded ? "" : "cannot load");
+    destroy_texture(texture);
+}
+
+//  Texture files are written to the data directory and removed afterwards
+static void check_texture_files(const char* data_dir)
+{
+    char path[MAX_PATH_LENGTH];
+    char saved_path[MAX_PATH_LENGTH];
+    color_t pixels[TEXTURE_FILE_WIDTH * TEXTURE_FILE_HEIGHT];
+    for (int i = 0; i < TEXTURE_FILE_WIDTH * TEXTURE_FILE_HEIGHT; ++i)
+    {
+        pixels[i].channels[0] = (unsigned char)(i * 37);
+        pixels[i].channels[1] = (unsigned char)(i * 11 + 5);
+        pixels[i].channels[2] = (unsigned char)(255 - i);
+    }
+    texture_t reference;
+    texture_t texture;
+    if (!create_texture(&reference, pixels, TEXTURE_FILE_WIDTH, TEXTURE_FILE_HEIGHT))
+    {
+        report(0, "texture creation", "");
+        return;
+    }
+
+    sprintf(path, "%s/scratch_texture.ppm", data_dir);
+    FILE* fp = fopen(path, "wb");
+    if (fp)
+    {
+        fprintf(fp, "P6\n# comment\n%d %d\n255\n", TEXTURE_FILE_WIDTH, TEXTURE_FILE_HEIGHT);
+        fwrite(pixels, sizeof(color_t), TEXTURE_FILE_WIDTH * TEXTURE_FILE_HEIGHT, fp);
+        fclose(fp);
+    }
+    check_loaded_texture("load_ppm_texture P6", load_ppm_texture(&texture, path), &texture, &reference);
+    fp = fopen(path, "w");
+    if (fp)
+    {
+        fprintf(fp, "P3\n%d %d\n255\n", TEXTURE_FILE_WIDTH, TEXTURE_FILE_HEIGHT);
+        for (int i = 0; i < TEXTURE_FILE_WIDTH * TEXTURE_FILE_HEIGHT; ++i)
+            fprintf(fp, "%d %d %d\n", pixels[i].channels[0], pixels[i].channels[1], pixels[i].channels[2]);
+        fclose(fp);
+    }
+    check_loaded_texture("load_ppm_texture P3", load_ppm_texture(&texture, path), &texture, &reference);
+    remove(path);
+
+    sprintf(path, "%s/scratch_texture.raw", data_dir);
+    write_file(path, pixels, sizeof(pixels));
+    check_loaded_texture("load_raw_texture", load_raw_texture(&texture, path, TEXTURE_FILE_WIDTH, TEXTURE_FILE_HEIGHT), &texture, &reference);
+    report(!load_raw_texture(&texture, path, TEXTURE_FILE_WIDTH, TEXTURE_FILE_HEIGHT + 1), "load_raw_texture rejects a short file", "");
+    remove(path);
+
+    sprintf(saved_path, "%s/scratch_texture.rttx", data_dir);
+    report(save_texture(&reference, saved_path), "save_texture", saved_path);
+    const int mapped = map_texture(&texture, saved_path);
+    int same_samples = mapped;
+    for (int i = 0; same_samples && i < 64; ++i)
+    {
+        const real_t u = real_mul(real_from_int(i % 8), REAL(0.15));
+        const real_t v = real_mul(real_from_int(i / 8), REAL(0.2));
+        const real_t footprint = real_mul(real_from_int(i % 5), REAL(0.1));
+        const color_t expected = sample_texture(&reference, u, v, footprint);
+        const color_t sampled = sample_texture(&texture, u, v, footprint);
+        same_samples = memcmp(&expected, &sampled, sizeof(color_t)) == 0;
+    }
+    report(same_samples && same_texture(&texture, &reference), "map_texture round trip", mapped ? "" : "cannot map");
+    destroy_texture(&texture);
+
+    //  Truncated files and foreign headers must not be mapped
+    fp = fopen(saved_path, "rb");
+    size_t size = 0;
+    char* data = 0;
+    if (fp && fseek(fp, 0, SEEK_END) == 0)
+    {
+        size = (size_t)ftell(fp);
+        data = malloc(size);
+        rewind(fp);
+        if (data && fread(data, 1, size, fp) != size)
+            size = 0;
+    }
+    if (fp)
+        fclose(fp);
+    if (data && size > 0)
+    {
+        write_file(saved_path, data, size - 1);
+        report(!map_texture(&texture, saved_path), "map_texture rejects a truncated file", "");
+        destroy_texture(&texture);
+        data[0] = 'X';
+        write_file(saved_path, data, size);
+        report(!map_texture(&texture, saved_path), "map_texture rejects a wrong magic", "");
+        destroy_texture(&texture);
+    }
+    else
+    {
+        report(0, "map_texture validation", "cannot read the saved texture");
+    }
+    free(data);
+    remove(saved_path);
+    destroy_texture(&reference);
+}
+
+typedef void (*build_scene_func)(test_scene* test);
+
+typedef struct
+{
+    const char* name;
+    build_scene_func build_func;
+} reference_scene;
+
+static int load_golden_image(const char* path, color_t* pixels)
+{
+    FILE* fp = fopen(path, "rb");
+    if (!fp)
+        return 0;
+    int width = 0;
+    int height = 0;
+    int max_value = 0;
+    int loaded = fscanf(fp, "P6 %d %d %d", &width, &height, &max_value) == 3 && width == IMAGE_WIDTH && height == IMAGE_HEIGHT && max_value == 255;
+    if (loaded)
+    {
+        fgetc(fp);
+        loaded = fread(pixels, sizeof(color_t), IMAGE_WIDTH * IMAGE_HEIGHT, fp) == IMAGE_WIDTH * IMAGE_HEIGHT;
+    }
+    fclose(fp);
+    return loaded;
+}
+
+static int save_golden_image(const char* path)
+{
+    FILE* fp = fopen(path, "wb");
+    if (!fp)
+        return 0;
+    fprintf(fp, "P6\n%d %d\n255\n", IMAGE_WIDTH, IMAGE_HEIGHT);
+    int saved = 1;
+    for (int row = 0; row < IMAGE_HEIGHT; ++row)
+        saved = saved && fwrite(image[row], sizeof(color_t), IMAGE_WIDTH, fp) == IMAGE_WIDTH;
+    return fclose(fp) == 0 && saved;
+}
+
+static void compare_with_golden_image(const char* name, const char* path)
+{
+    static color_t golden[IMAGE_WIDTH * IMAGE_HEIGHT];
+    char details[MAX_PATH_LENGTH + 128];
+    char check[128];
+    sprintf(check, "%s golden image", name);
+    if (!load_golden_image(path, golden))
+    {
+        sprintf(details, "cannot read %s", path);
+        report(0, check, details);
+        return;
+    }
+    int mismatched = 0;
+    int max_difference = 0;
+    for (int row = 0; row < IMAGE_HEIGHT; ++row)
+    {
+        for (int col = 0; col < IMAGE_WIDTH; ++col)
+        {
+            int difference = 0;
+            for (int channel = 0; channel < 3; ++channel)
+                difference = RAY_TRACER_MAX(difference, abs(image[row][col].channels[channel] - golden[row * IMAGE_WIDTH + col].channels[channel]));
+            max_difference = RAY_TRACER_MAX(max_difference, difference);
+            if (difference > PIXEL_TOLERANCE)
+                ++mismatched;
+        }
+    }
+    const double mismatched_percent = 100.0 * mismatched / (IMAGE_WIDTH * IMAGE_HEIGHT);
+    sprintf(details, "%.2f%% pixels off by more than %d (max %d), budget %.2f%%", mismatched_percent, PIXEL_TOLERANCE, max_difference, MISMATCHED_PIXELS_PERCENT);
+    report(mismatched_percent <= MISMATCHED_PIXELS_PERCENT, check, details);
+}
+
+static double benchmark_scene(test_scene* test)
+{
+    double best_ms = 0;
+    for (int run = 0; run < BENCHMARK_RUNS; ++run)
+    {
+        const clock_t start = clock();
+        trace_scene(&test->scene, BENCHMARK_WIDTH, BENCHMARK_HEIGHT, put_pixel_func);
+        const double ms = 1000.0 * (clock() - start) / CLOCKS_PER_SEC;
+        if (run == 0 || ms < best_ms)
+            best_ms = ms;
+    }
+    return best_ms;
+}
+
+//  Budgets files hold "<scene name> <milliseconds>" lines, scenes without a line are not timed
+static double find_budget(const char* data_dir, const char* name)
+{
+    char path[MAX_PATH_LENGTH];
+    sprintf(path, "%s/" BUDGETS_FILE, data_dir);
+    FILE* fp = fopen(path, "r");
+    if (!fp)
+        return -1.0;
+    char scene_name[128];
+    double budget_ms = 0;
+    double res = -1.0;
+    while (fscanf(fp, "%127s %lf", scene_name, &budget_ms) == 2)
+    {
+        if (strcmp(scene_name, name) == 0)
+            res = budget_ms;
+    }
+    fclose(fp);
+    return res;
+}
+
+static void check_scene(const reference_scene* reference, const char* data_dir, const int update)
+{
+    char path[MAX_PATH_LENGTH];
+    char check[128];
+    char details[128];
+    sprintf(path, "%s/golden/%s.ppm", data_dir, reference->name);
+    test_scene test;
+    if (reference->build_func)
+    {
+        init_test_scene(&test);
+        reference->build_func(&test);
+    }
+    else
+    {
+        memset(&test, 0, sizeof(test_scene));
+        init_scene(&test.scene);
+    }
+    trace_scene(&test.scene, IMAGE_WIDTH, IMAGE_HEIGHT, put_pixel_func);
+    if (update)
+    {
+        sprintf(check, "%s golden image update", reference->name);
+        report(save_golden_image(path), check, path);
+    }
+    else
+    {
+        compare_with_golden_image(reference->name, path);
+        const double budget_ms = find_budget(data_dir, reference->name);
+        if (budget_ms >= 0)
+        {
+            const double ms = benchmark_scene(&test);
+            sprintf(check, "%s benchmark", reference->name);
+            sprintf(details, "%.1f ms for %dx%d, budget %.1f ms", ms, BENCHMARK_WIDTH, BENCHMARK_HEIGHT, budget_ms);
+            report(ms <= budget_ms, check, details);
+        }
+    }
+    if (reference->build_func)
+        destroy_test_scene(&test);
+    else
+        destroy_scene(&test.scene);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        printf("Usage: %s <data_dir> [--update]\n", argv[0]);
+        return 2;
+    }
+    const int update = argc > 2 && strcmp(argv[2], "--update") == 0;
+    const reference_scene scenes[] = {
+        { "default", 0 },
+        { "textured", build_textured_scene },
+        { "instanced", build_instanced_scene }
+    };
+    if (!update)
+    {
+        check_analytic_results();
+        check_incremental_rendering();
+        check_texture_files(argv[1]);
+    }
+    for (size_t i = 0; i < sizeof(scenes) / sizeof(scenes[0]); ++i)
+        check_scene(&scenes[i], argv[1], update);
+    printf("%d check(s) failed\n", failures_count);
+    return failures_count == 0 ? 0 : 1;
+}